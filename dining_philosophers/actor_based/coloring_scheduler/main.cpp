@@ -0,0 +1,364 @@
+#include <dining_philosophers/actor_based/common/philosopher.hpp>
+#include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/actor_based/common/trace_observer_agent.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+
+//
+// Round-based scheduling by colors.
+//
+// Philosophers are colored in such a way that neighbors have different
+// colors: two colors are enough for even count of philosophers, three
+// colors are necessary for odd count. Philosophers of the same color never
+// compete for forks, so they can eat at the same time.
+//
+// The scheduler runs rounds by colors. A philosopher gets forks only in
+// the round of his/her color and only once per round. A round ends when
+// all philosophers of its color have eaten (or have completed their work),
+// or when the time limit of the round expires. The next round starts
+// when all forks are returned.
+//
+// Requests from philosophers of other colors are kept until their round,
+// so there are no 'busy' replies.
+//
+
+// Coloring of the table.
+std::vector< std::size_t > make_coloring( std::size_t count )
+{
+	std::vector< std::size_t > colors( count );
+	for( std::size_t i{}; i != count; ++i )
+		colors[ i ] = i % 2u;
+
+	// The first and the last philosophers are neighbors.
+	if( count > 1u && 0u != count % 2u )
+		colors.back() = 2u;
+
+	return colors;
+}
+
+class scheduler_t final : public so_5::agent_t
+{
+	// Signal about the end of the time for a round.
+	struct round_timeout_t final : public so_5::message_t
+	{
+		const std::uint64_t m_round;
+
+		explicit round_timeout_t( std::uint64_t round ) : m_round{ round } {}
+	};
+
+public :
+	scheduler_t(
+		context_t ctx,
+		std::size_t count,
+		const reply_table_t & replies,
+		int meals_count,
+		// Zero means there is no limit.
+		std::chrono::milliseconds round_limit )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_replies{ replies }
+		,	m_meals_count{ meals_count }
+		,	m_round_limit{ round_limit }
+		,	m_colors{ make_coloring( count ) }
+		,	m_colors_count{ *std::max_element( m_colors.begin(), m_colors.end() ) + 1u }
+		,	m_philosophers( count )
+		,	m_fork_holders( count, no_holder )
+	{
+		m_fork_mboxes.reserve( count );
+		for( std::size_t i{}; i != count; ++i )
+			m_fork_mboxes.push_back( so_environment().create_mbox() );
+	}
+
+	// Get mbox of fork with specified index.
+	const so_5::mbox_t & fork_mbox( std::size_t index ) const noexcept
+	{
+		return m_fork_mboxes[ index ];
+	}
+
+	void so_define_agent() override
+	{
+		for( std::size_t i{}; i != m_fork_mboxes.size(); ++i )
+		{
+			so_subscribe( fork_mbox( i ) )
+				.event( [i, this]( mhood_t<take_t> cmd ) {
+						on_take_fork( cmd->m_philosopher_index, i );
+					} )
+				.event( [i, this]( mhood_t<put_t> ) {
+						on_put_fork( i );
+					} );
+		}
+
+		so_subscribe_self().event( [this]( mhood_t<round_timeout_t> cmd ) {
+				if( cmd->m_round == m_round && !m_round_closed )
+				{
+					m_round_closed = true;
+					try_finish_round();
+				}
+			} );
+	}
+
+	void so_evt_start() override
+	{
+		start_round();
+	}
+
+	void so_evt_finish() override
+	{
+		fmt::print( "scheduler: colors: {}, rounds: {}, ended early: {}, "
+				"avg eaters per round: {:.2f}\n",
+				m_colors_count,
+				m_round,
+				m_rounds_ended_early,
+				m_round ? static_cast< double >( m_meals ) / m_round : 0.0 );
+	}
+
+private :
+	static constexpr std::size_t no_holder = static_cast< std::size_t >( -1 );
+
+	struct philosopher_info_t
+	{
+		int m_meals{};
+		// Has eaten in the current round.
+		bool m_served{ false };
+		// Waits for the left fork.
+		bool m_pending{ false };
+	};
+
+	const reply_table_t & m_replies;
+	const int m_meals_count;
+	const std::chrono::milliseconds m_round_limit;
+
+	const std::vector< std::size_t > m_colors;
+	const std::size_t m_colors_count;
+
+	std::vector< so_5::mbox_t > m_fork_mboxes;
+
+	std::vector< philosopher_info_t > m_philosophers;
+	std::vector< std::size_t > m_fork_holders;
+
+	std::size_t m_current_color{};
+	// Number of the current round (starting from 1).
+	std::uint64_t m_round{};
+	// No more philosophers are admitted in the current round.
+	bool m_round_closed{ false };
+	// Count of philosophers those are eating now.
+	std::size_t m_eating{};
+
+	std::uint64_t m_meals{};
+	std::uint64_t m_rounds_ended_early{};
+
+	bool is_completed( std::size_t philosopher ) const noexcept
+	{
+		return m_meals_count == m_philosophers[ philosopher ].m_meals;
+	}
+
+	void on_take_fork( std::size_t philosopher, std::size_t fork_index )
+	{
+		// Use the fact that index of left fork is always equal to
+		// index of the philosopher itself.
+		if( fork_index != philosopher )
+		{
+			// The right fork is always free: neighbors can't eat
+			// in the same round.
+			give_fork( philosopher, fork_index );
+			return;
+		}
+
+		auto & info = m_philosophers[ philosopher ];
+		if( can_be_admitted( philosopher ) )
+			admit( philosopher );
+		else
+			info.m_pending = true;
+	}
+
+	void on_put_fork( std::size_t fork_index )
+	{
+		const auto philosopher = m_fork_holders[ fork_index ];
+		m_fork_holders[ fork_index ] = no_holder;
+
+		const auto right = (philosopher + 1u) % m_fork_holders.size();
+		if( no_holder == m_fork_holders[ philosopher ] &&
+				no_holder == m_fork_holders[ right ] )
+		{
+			// Both forks are returned, the meal is over.
+			--m_eating;
+			++m_philosophers[ philosopher ].m_meals;
+			++m_meals;
+			try_finish_round();
+		}
+	}
+
+	bool can_be_admitted( std::size_t philosopher ) const noexcept
+	{
+		return !m_round_closed &&
+				m_current_color == m_colors[ philosopher ] &&
+				!m_philosophers[ philosopher ].m_served;
+	}
+
+	void admit( std::size_t philosopher )
+	{
+		auto & info = m_philosophers[ philosopher ];
+		info.m_pending = false;
+		info.m_served = true;
+		++m_eating;
+
+		give_fork( philosopher, philosopher );
+
+		// The round can be closed if all its members are served.
+		if( all_members_served() )
+			m_round_closed = true;
+	}
+
+	void give_fork( std::size_t philosopher, std::size_t fork_index )
+	{
+		m_fork_holders[ fork_index ] = philosopher;
+		so_5::send< taken_t >( m_replies.reply_mbox( philosopher ) );
+	}
+
+	bool all_members_served() const noexcept
+	{
+		for( std::size_t i{}; i != m_philosophers.size(); ++i )
+			if( m_current_color == m_colors[ i ] &&
+					!m_philosophers[ i ].m_served && !is_completed( i ) )
+				return false;
+
+		return true;
+	}
+
+	void try_finish_round()
+	{
+		if( 0u != m_eating )
+			return;
+
+		if( all_members_served() )
+		{
+			// There is no need to wait for the time limit.
+			if( m_round_limit.count() )
+				++m_rounds_ended_early;
+			start_next_round();
+		}
+		else if( m_round_closed )
+			start_next_round();
+	}
+
+	void start_next_round()
+	{
+		// Colors without active philosophers are skipped.
+		for( std::size_t i{}; i != m_colors_count; ++i )
+		{
+			m_current_color = (m_current_color + 1u) % m_colors_count;
+			if( has_active_members() )
+			{
+				start_round();
+				return;
+			}
+		}
+		// All philosophers have completed their work.
+	}
+
+	bool has_active_members() const noexcept
+	{
+		for( std::size_t i{}; i != m_philosophers.size(); ++i )
+			if( m_current_color == m_colors[ i ] && !is_completed( i ) )
+				return true;
+
+		return false;
+	}
+
+	void start_round()
+	{
+		++m_round;
+		m_round_closed = false;
+
+		for( std::size_t i{}; i != m_philosophers.size(); ++i )
+			if( m_current_color == m_colors[ i ] )
+				m_philosophers[ i ].m_served = false;
+
+		if( m_round_limit.count() )
+			so_5::send_delayed< round_timeout_t >( *this, m_round_limit, m_round );
+
+		// Requests those wait for that round.
+		for( std::size_t i{}; i != m_philosophers.size(); ++i )
+			if( m_philosophers[ i ].m_pending && can_be_admitted( i ) )
+				admit( i );
+	}
+};
+
+void run_simulation(
+	so_5::environment_t & env,
+	const names_holder_t & names,
+	std::chrono::milliseconds round_limit,
+	const trace::observers_params_t & observers_params )
+{
+	env.introduce_coop( [&]( so_5::coop_t & coop ) {
+		coop.make_agent_with_binder< trace_maker_t >(
+				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				names,
+				random_pause_generator_t::trace_step() );
+
+		make_trace_observers( coop,
+				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				names,
+				observers_params );
+
+		coop.make_agent_with_binder< completion_watcher_t >(
+				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				names );
+
+		const auto count = names.size();
+
+		// Mboxes of philosophers for replies from the scheduler.
+		auto * replies = coop.take_under_control(
+				std::make_unique< reply_table_t >( count ) );
+
+		auto * scheduler = coop.make_agent< scheduler_t >(
+				count,
+				*replies,
+				default_meals_count,
+				round_limit );
+
+		for( std::size_t i{}; i != count; ++i )
+		{
+			auto * philosopher = coop.make_agent< philosopher_t >(
+					i,
+					scheduler->fork_mbox( i ),
+					scheduler->fork_mbox( (i + 1) % count ),
+					default_meals_count );
+			replies->register_philosopher( i, philosopher->so_direct_mbox() );
+		}
+	});
+}
+
+int main( int argc, char ** argv )
+{
+	try
+	{
+		const cmd_line_args_t args{ argc, argv };
+		// Time limit for a round can be set by `--round-limit MILLISECONDS`.
+		// Zero means that a round lasts till all its members have eaten.
+		const std::chrono::milliseconds round_limit{
+				std::stoul( args.value_or( "--round-limit", "150" ) ) };
+		const auto observers_params =
+				trace::observers_params_t::from_cmd_line( args );
+
+		names_holder_t names{
+			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
+			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"
+		};
+
+		so_5::launch( [&]( so_5::environment_t & env ) {
+				run_simulation( env, names, round_limit, observers_params );
+			} );
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Error: " << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,44 +1,142 @@
 #pragma once
 
 #include <dining_philosophers/common/types.hpp>
+#include <dining_philosophers/common/completion_summary.hpp>
 
 #include <so_5/all.hpp>
 
 #include <fmt/format.h>
 
+#include <atomic>
+
+//
+// completion_latch_t
+//
+// Count of philosophers those haven't completed yet. Only the last
+// philosopher sends a notification, so there is one message for the
+// whole table instead of one message per philosopher.
+//
+class completion_latch_t
+{
+public :
+	struct all_done_t final : public so_5::signal_t {};
+
+	completion_latch_t( so_5::environment_t & env, std::size_t count )
+		:	m_mbox{ env.create_mbox() }
+		,	m_remaining{ count }
+	{}
+
+	const so_5::mbox_t & mbox() const noexcept { return m_mbox; }
+
+	void count_down()
+	{
+		if( 1u == m_remaining.fetch_sub( 1u, std::memory_order_acq_rel ) )
+			so_5::send< all_done_t >( m_mbox );
+	}
+
+private :
+	const so_5::mbox_t m_mbox;
+	std::atomic< std::size_t > m_remaining;
+};
+
 //
 // completion_watcher_t
 //
+// Stops the environment when all philosophers have completed.
+//
+// Only a sample of completed philosophers and the summary are shown
+// (nothing is shown in the quiet mode).
+//
+// Philosophers of all tables of the environment use the same mbox for
+// notifications. If there are several tables only the total count of
+// completed philosophers is checked.
+//
+// If philosophers use completion_latch_t the watcher waits only for
+// the notification from the latch and shows nothing.
+//
 class completion_watcher_t final : public so_5::agent_t
 {
 	const names_holder_t & m_names;
-	std::size_t m_completed{};
+	const std::size_t m_tables_count;
+	const bool m_verbose;
+	completion_summary_t m_summary;
 
 	static auto make_mbox( so_5::environment_t & env )
 	{
 		return env.create_mbox( "completion_watcher" );
 	}
 
-public :
-	completion_watcher_t( context_t ctx, const names_holder_t & names )
+	static const names_holder_t & no_names()
+	{
+		static const names_holder_t names;
+		return names;
+	}
+
+	completion_watcher_t(
+		context_t ctx,
+		const names_holder_t & names,
+		std::size_t tables_count,
+		bool verbose )
 		:	so_5::agent_t{ std::move(ctx) }
 		,	m_names{ names }
+		,	m_tables_count{ tables_count }
+		,	m_verbose{ verbose }
+		,	m_summary{ names.size(),
+				verbose ? completion_summary_t::default_sample_size : 0u }
 	{
 		so_subscribe( make_mbox( so_environment() ) )
 				.event( [this]( mhood_t<philosopher_done_t> cmd ) {
-					fmt::print( "{}: done\n", m_names[ cmd->m_philosopher_index ] );
+					if( m_summary.is_sampled( cmd->m_philosopher_index ) )
+						fmt::print( "{}: done, busy replies: {}, timeouts: {}\n",
+								m_names[ cmd->m_philosopher_index ],
+								cmd->m_busy_replies,
+								cmd->m_timeouts );
 
-					++m_completed;
-					if( m_completed == m_names.size() )
+					m_summary.add( *cmd );
+					if( m_summary.completed() == m_names.size() * m_tables_count )
+					{
+						if( m_verbose )
+							m_summary.show();
 						so_environment().stop();
+					}
+				} );
+	}
+
+public :
+	completion_watcher_t( context_t ctx, const names_holder_t & names )
+		:	completion_watcher_t{ std::move(ctx), names, 1u, true }
+	{}
+
+	// Completion of every philosopher isn't shown in that case.
+	completion_watcher_t(
+		context_t ctx,
+		const names_holder_t & names,
+		std::size_t tables_count )
+		:	completion_watcher_t{ std::move(ctx), names, tables_count, false }
+	{}
+
+	// Quiet mode: only the notification from the latch is handled.
+	completion_watcher_t( context_t ctx, const completion_latch_t & latch )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_names{ no_names() }
+		,	m_tables_count{ 0u }
+		,	m_verbose{ false }
+		,	m_summary{ 0u, 0u }
+	{
+		so_subscribe( latch.mbox() )
+				.event( [this]( mhood_t<completion_latch_t::all_done_t> ) {
+					so_environment().stop();
 				} );
 	}
 
 	static void done(
 		so_5::environment_t & env,
-		std::size_t philosopher_index )
+		std::size_t philosopher_index,
+		unsigned int busy_replies = 0u,
+		unsigned int timeouts = 0u )
 	{
-		so_5::send< philosopher_done_t >( make_mbox(env), philosopher_index );
+		so_5::send< philosopher_done_t >(
+				make_mbox(env), philosopher_index, busy_replies, timeouts );
 	}
 };
 
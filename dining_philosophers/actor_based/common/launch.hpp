@@ -0,0 +1,50 @@
+#pragma once
+
+#include <so_5/all.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+
+//
+// Launch of a simulation in the default or in the single-threaded mode.
+//
+// In the single-threaded mode the not-MT-safe environment infrastructure
+// is used: the timer and the default dispatcher work on the main thread
+// and there is no synchronization inside SObjectizer. Because of that all
+// agents must be bound to the default dispatcher in that mode.
+//
+
+// Binder for auxiliary agents like trace_maker_t and completion_watcher_t.
+// They have own threads in the default mode.
+inline so_5::disp_binder_shptr_t auxiliary_binder(
+	so_5::environment_t & env,
+	bool single_threaded )
+{
+	if( single_threaded )
+		return so_5::make_default_disp_binder( env );
+
+	return so_5::disp::one_thread::make_dispatcher( env ).binder();
+}
+
+// Runs the simulation and prints its duration.
+// Additional params of the environment can be set by tuner.
+template< typename Init, typename Tuner >
+void launch_simulation( bool single_threaded, Init && init, Tuner && tuner )
+{
+	const auto started_at = std::chrono::steady_clock::now();
+
+	so_5::launch(
+			std::forward< Init >( init ),
+			[single_threaded, &tuner]( so_5::environment_params_t & params ) {
+				if( single_threaded )
+					params.infrastructure_factory(
+							so_5::env_infrastructures::simple_not_mtsafe::factory() );
+				tuner( params );
+			} );
+
+	fmt::print( "{} mode, elapsed time: {:.3f}s\n",
+			single_threaded ? "single-threaded" : "multithreaded",
+			std::chrono::duration< double >(
+					std::chrono::steady_clock::now() - started_at ).count() );
+}
@@ -5,28 +5,131 @@
 #include <dining_philosophers/actor_based/trace_maker/all.hpp>
 #include <dining_philosophers/actor_based/common/completion_watcher.hpp>
 
-class philosopher_t final
-	: public so_5::agent_t
-	, private random_pause_generator_t
+#include <string>
+#include <type_traits>
+
+//
+// Policies for basic_philosopher_t.
+//
+namespace philosopher_policies {
+
+// States are named and every change of state is sent to trace_maker_t.
+struct state_tracing_t
+{
+	static constexpr bool enabled = true;
+
+	static auto make_listener( so_5::environment_t & env, std::size_t index )
+	{
+		return state_watcher_t::make( env, index );
+	}
+};
+
+// There is no state listener and states have no names.
+struct no_tracing_t
+{
+	static constexpr bool enabled = false;
+};
+
+// All pauses are zero, so only the cost of the coordination is measured.
+struct zero_pauses_t
+{
+	auto think_pause( thinking_type_t ) const noexcept
+	{
+		return std::chrono::milliseconds::zero();
+	}
+
+	auto hungry_think_pause( const hungry_backoff_t & ) const noexcept
+	{
+		return std::chrono::milliseconds::zero();
+	}
+
+	auto eat_pause() const noexcept
+	{
+		return std::chrono::milliseconds::zero();
+	}
+};
+
+// Completion is reported to completion_watcher_t.
+struct completion_watcher_notification_t
+{
+	static void done(
+		so_5::environment_t & env,
+		std::size_t philosopher_index,
+		unsigned int busy_replies )
+	{
+		completion_watcher_t::done( env, philosopher_index, busy_replies );
+	}
+};
+
+// Completion is counted by completion_latch_t shared by all philosophers
+// of the table. Busy replies aren't collected.
+class completion_latch_notification_t
+{
+public :
+	explicit completion_latch_notification_t( completion_latch_t & latch ) noexcept
+		:	m_latch{ &latch }
+	{}
+
+	void done( so_5::environment_t &, std::size_t, unsigned int ) const
+	{
+		m_latch->count_down();
+	}
+
+private :
+	completion_latch_t * m_latch;
+};
+
+// Names of states are necessary only for the tracing.
+template< typename Tracing >
+std::string state_name( const char * name )
+{
+	if constexpr( Tracing::enabled )
+		return name;
+	else
+		return {};
+}
+
+// Tracing can be turned off for all examples by
+// DINING_PHILOSOPHERS_NO_TRACING macro (see DINING_PHILOSOPHERS_NO_TRACING
+// option in CMakeLists.txt).
+#if defined(DINING_PHILOSOPHERS_NO_TRACING)
+using default_tracing_t = no_tracing_t;
+#else
+using default_tracing_t = state_tracing_t;
+#endif
+
+} /* namespace philosopher_policies */
+
+template<
+	typename Tracing = philosopher_policies::default_tracing_t,
+	typename Pauses = random_pause_generator_t,
+	typename Completion = philosopher_policies::completion_watcher_notification_t >
+class basic_philosopher_t final : public so_5::agent_t
 {
 	struct stop_thinking_t : public so_5::signal_t {};
 	struct stop_eating_t : public so_5::signal_t {};
 
 public :
-	philosopher_t(
+	basic_philosopher_t(
 		context_t ctx,
 		std::size_t index,
 		so_5::mbox_t left_fork,
 		so_5::mbox_t right_fork,
-		int meals_count )
+		int meals_count,
+		backoff_policy_t backoff_policy = backoff_policy_t::uniform,
+		Completion completion = Completion{} )
 		:	so_5::agent_t{ std::move(ctx) }
 		,	m_index{ index }
 		,	m_left_fork{ std::move( left_fork ) }
 		,	m_right_fork{ std::move( right_fork ) }
 		,	m_meals_count{ meals_count }
+		,	m_pauses{ make_pauses( index ) }
+		,	m_backoff{ backoff_policy }
+		,	m_completion{ std::move(completion) }
 	{
-		so_add_destroyable_listener(
-				state_watcher_t::make( so_environment(), index ) );
+		if constexpr( Tracing::enabled )
+			so_add_destroyable_listener(
+					Tracing::make_listener( so_environment(), index ) );
 	}
 
 	void so_define_agent() override
@@ -34,30 +137,32 @@ public :
 		st_thinking
 			.event( [this](mhood_t<stop_thinking_t>) {
 				this >>= st_wait_left;
-				so_5::send< take_t >( m_left_fork, so_direct_mbox(), m_index );
+				so_5::send< take_t >( m_left_fork, m_index );
 			} );
 
 		st_wait_left
 			.event( [this](mhood_t<taken_t>) {
 				this >>= st_wait_right;
-				so_5::send< take_t >( m_right_fork, so_direct_mbox(), m_index );
+				so_5::send< take_t >( m_right_fork, m_index );
 			} )
 			.event( [this](mhood_t<busy_t>) {
-				think( st_hungry_thinking );
+				on_busy();
 			} );
 
 		st_wait_right
 			.event( [this](mhood_t<taken_t>) {
+				m_backoff.on_success();
 				this >>= st_eating;
 			} )
 			.event( [this](mhood_t<busy_t>) {
 				so_5::send< put_t >( m_left_fork );
-				think( st_hungry_thinking );
+				on_busy();
 			} );
 
 		st_eating
 			.on_enter( [this] {
-					so_5::send_delayed< stop_eating_t >( *this, eat_pause() );
+					so_5::send_delayed< stop_eating_t >(
+							*this, m_pauses.eat_pause() );
 				} )
 			.event( [this](mhood_t<stop_eating_t>) {
 				so_5::send< put_t >( m_right_fork );
@@ -72,7 +177,7 @@ public :
 
 		st_done
 			.on_enter( [this] {
-				completion_watcher_t::done( so_environment(), m_index );
+				m_completion.done( so_environment(), m_index, m_busy_replies );
 			} );
 	}
 
@@ -82,15 +187,31 @@ public :
 	}
 
 private :
-	state_t st_thinking{ this, "thinking" };
-	state_t st_normal_thinking{ initial_substate_of{ st_thinking }, "normal" };
-	state_t st_hungry_thinking{ substate_of{ st_thinking }, "hungry" };
+	static std::string state_name( const char * name )
+	{
+		return philosopher_policies::state_name< Tracing >( name );
+	}
+
+	// Pauses are seeded by the index of the philosopher if it's supported.
+	static Pauses make_pauses( std::size_t index )
+	{
+		if constexpr( std::is_constructible_v< Pauses, std::size_t > )
+			return Pauses{ index };
+		else
+			return Pauses{};
+	}
+
+	state_t st_thinking{ this, state_name( "thinking" ) };
+	state_t st_normal_thinking{
+			initial_substate_of{ st_thinking }, state_name( "normal" ) };
+	state_t st_hungry_thinking{
+			substate_of{ st_thinking }, state_name( "hungry" ) };
 
-	state_t st_wait_left{ this, "wait_left" };
-	state_t st_wait_right{ this, "wait_right" };
-	state_t st_eating{ this, "eating" };
+	state_t st_wait_left{ this, state_name( "wait_left" ) };
+	state_t st_wait_right{ this, state_name( "wait_right" ) };
+	state_t st_eating{ this, state_name( "eating" ) };
 
-	state_t st_done{ this, "done" };
+	state_t st_done{ this, state_name( "done" ) };
 
 	const std::size_t m_index;
 
@@ -100,13 +221,31 @@ private :
 	const int m_meals_count;
 	int m_meals_eaten{};
 
+	Pauses m_pauses;
+
+	// Duration of hungry thinking depends on the previous attempts.
+	hungry_backoff_t m_backoff;
+	unsigned int m_busy_replies{};
+
+	Completion m_completion;
+
+	void on_busy()
+	{
+		++m_busy_replies;
+		m_backoff.on_busy();
+		think( st_hungry_thinking );
+	}
+
 	void think( const state_t & target_st )
 	{
 		this >>= target_st;
 		so_5::send_delayed< stop_thinking_t >(
 				*this,
-				think_pause( target_st == st_normal_thinking
-						? thinking_type_t::normal : thinking_type_t::hungry ) );
+				target_st == st_normal_thinking
+						? m_pauses.think_pause( thinking_type_t::normal )
+						: m_pauses.hungry_think_pause( m_backoff ) );
 	}
 };
 
+// Philosopher used by most of examples.
+using philosopher_t = basic_philosopher_t<>;
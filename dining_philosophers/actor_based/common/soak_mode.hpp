@@ -0,0 +1,79 @@
+#pragma once
+
+#include <dining_philosophers/common/soak_trace.hpp>
+#include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/common/random_generator.hpp>
+#include <dining_philosophers/actor_based/common/trace_observer_agent.hpp>
+
+//
+// soak_params_t
+//
+// Params for endless runs. Soak mode is turned on by `--soak` flag.
+// In that mode philosophers never finish and only the last transitions
+// are kept in the trace.
+//
+struct soak_params_t
+{
+	bool m_enabled;
+	// Count of transitions to be kept for every philosopher.
+	std::size_t m_window_size;
+	// Period for showing the window and counters.
+	std::chrono::seconds m_render_period;
+
+	// `--soak-window COUNT` and `--soak-report SECONDS` can be used
+	// for tuning of soak mode.
+	static soak_params_t from_cmd_line( const cmd_line_args_t & args )
+	{
+		soak_params_t result{
+			args.has_flag( "--soak" ),
+			std::stoul( args.value_or( "--soak-window", "32" ) ),
+			std::chrono::seconds{
+					std::stoul( args.value_or( "--soak-report", "60" ) ) }
+		};
+
+		if( 0u == result.m_window_size )
+			throw std::invalid_argument( "soak window should not be empty" );
+		if( std::chrono::seconds::zero() == result.m_render_period )
+			throw std::invalid_argument( "soak report period should not be zero" );
+
+		return result;
+	}
+
+	int meals_count() const noexcept
+	{
+		return m_enabled ? unlimited_meals_count : default_meals_count;
+	}
+};
+
+// Makes trace_maker_t for the usual mode or an agent with
+// trace::soak_trace_t for soak mode.
+inline void make_trace_maker(
+	so_5::coop_t & coop,
+	so_5::disp_binder_shptr_t binder,
+	const names_holder_t & names,
+	const soak_params_t & params )
+{
+	if( !params.m_enabled )
+		coop.make_agent_with_binder< trace_maker_t >(
+				std::move(binder),
+				names,
+				random_pause_generator_t::trace_step() );
+	else
+	{
+		trace::soak_trace_t::install_signal_handler();
+
+		trace::observers_t observers;
+		observers.push_back( std::make_unique< trace::soak_trace_t >(
+				names,
+				params.m_window_size,
+				random_pause_generator_t::trace_step(),
+				params.m_render_period ) );
+
+		coop.make_agent_with_binder< trace_observer_agent_t >(
+				std::move(binder),
+				std::move(observers),
+				// Requests from the signal handler are checked with that period.
+				std::chrono::milliseconds{ 250 } );
+	}
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <dining_philosophers/common/cmd_line.hpp>
+
+#include <so_5/all.hpp>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+//
+// stats_params_t
+//
+// Params for collecting of SObjectizer's run-time statistics.
+// Statistics isn't collected if file name is empty.
+//
+struct stats_params_t
+{
+	std::string m_file_name;
+	std::chrono::milliseconds m_period;
+
+	// Statistics is turned on by `--stats FILE` option.
+	// Period of distribution can be set by `--stats-period MILLISECONDS`.
+	static stats_params_t from_cmd_line( const cmd_line_args_t & args )
+	{
+		return {
+			args.value_or( "--stats", "" ),
+			std::chrono::milliseconds{
+					std::stoul( args.value_or( "--stats-period", "250" ) ) }
+		};
+	}
+
+	bool enabled() const noexcept { return !m_file_name.empty(); }
+
+	// Activity of work threads is tracked only if it is turned on
+	// at the start of the environment.
+	void tune( so_5::environment_params_t & params ) const
+	{
+		if( enabled() )
+			params.turn_work_thread_activity_tracking_on();
+	}
+};
+
+//
+// quantity_source_t
+//
+// Data source for a value of an application (like the length of
+// a waiter's queue). The value is updated by the owner and is read by
+// the stats thread of SObjectizer.
+//
+class quantity_source_t final : public so_5::stats::source_t
+{
+public :
+	// Suffix should be a string literal.
+	quantity_source_t( const std::string & prefix, const char * suffix )
+		:	m_prefix{ prefix.c_str() }
+		,	m_suffix{ suffix }
+	{}
+
+	void set( std::size_t value ) noexcept
+	{
+		m_value.store( value, std::memory_order_relaxed );
+	}
+
+	void distribute( const so_5::mbox_t & mbox ) override
+	{
+		so_5::send< so_5::stats::messages::quantity< std::size_t > >(
+				mbox,
+				m_prefix,
+				m_suffix,
+				m_value.load( std::memory_order_relaxed ) );
+	}
+
+private :
+	const so_5::stats::prefix_t m_prefix;
+	const so_5::stats::suffix_t m_suffix;
+	std::atomic< std::size_t > m_value{};
+};
+
+//
+// stats_collector_t
+//
+// Receives run-time statistics from SObjectizer and writes it into
+// a CSV file. Every line contains:
+//
+// time_ms,source,metric,value
+//
+// where time_ms is the time since the start of the collector, source is
+// a prefix of data source (with id of work thread for thread activity).
+// Cumulative working and waiting times of work threads are written in
+// microseconds as separate metrics.
+//
+class stats_collector_t final : public so_5::agent_t
+{
+public :
+	stats_collector_t( context_t ctx, const stats_params_t & params )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_period{ params.m_period }
+		,	m_file{ params.m_file_name }
+	{
+		if( !m_file )
+			throw std::runtime_error(
+					"unable to open stats file: " + params.m_file_name );
+
+		m_file << "time_ms,source,metric,value\n";
+	}
+
+	void so_define_agent() override
+	{
+		using namespace so_5::stats::messages;
+
+		so_subscribe( so_environment().stats_controller().mbox() )
+			.event( [this]( mhood_t<distribution_started> ) {
+					m_distribution_started_at = std::chrono::steady_clock::now();
+				} )
+			.event( [this]( mhood_t< quantity< std::size_t > > cmd ) {
+					write( cmd->m_prefix.as_string_view(),
+							cmd->m_suffix.as_string_view(),
+							cmd->m_value );
+				} )
+			.event( [this]( mhood_t<work_thread_activity> cmd ) {
+					std::ostringstream source;
+					source << cmd->m_prefix.as_string_view()
+							<< "/thread-" << cmd->m_thread_id;
+
+					using us_t = std::chrono::microseconds;
+					const auto & stats = cmd->m_stats;
+					write( source.str(), "working_us",
+							std::chrono::duration_cast< us_t >(
+									stats.m_working_stats.m_total_time ).count() );
+					write( source.str(), "waiting_us",
+							std::chrono::duration_cast< us_t >(
+									stats.m_waiting_stats.m_total_time ).count() );
+				} );
+	}
+
+	void so_evt_start() override
+	{
+		m_started_at = std::chrono::steady_clock::now();
+
+		auto & controller = so_environment().stats_controller();
+		controller.set_distribution_period( m_period );
+		controller.turn_on();
+	}
+
+	void so_evt_finish() override
+	{
+		so_environment().stats_controller().turn_off();
+	}
+
+private :
+	const std::chrono::milliseconds m_period;
+
+	std::ofstream m_file;
+
+	std::chrono::steady_clock::time_point m_started_at;
+	std::chrono::steady_clock::time_point m_distribution_started_at;
+
+	template< typename Source, typename Metric, typename Value >
+	void write( const Source & source, const Metric & metric, Value value )
+	{
+		m_file << fmt::format( "{},{},{},{}\n",
+				std::chrono::duration_cast< std::chrono::milliseconds >(
+						m_distribution_started_at - m_started_at ).count(),
+				source,
+				metric,
+				value );
+	}
+};
+
+// Adds the collector to the coop if statistics is turned on.
+inline void make_stats_collector(
+	so_5::coop_t & coop,
+	so_5::disp_binder_shptr_t binder,
+	const stats_params_t & params )
+{
+	if( params.enabled() )
+		coop.make_agent_with_binder< stats_collector_t >(
+				std::move(binder), params );
+}
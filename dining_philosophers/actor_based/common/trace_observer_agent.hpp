@@ -0,0 +1,78 @@
+#pragma once
+
+#include <dining_philosophers/common/observers.hpp>
+#include <dining_philosophers/actor_based/trace_maker/all.hpp>
+
+#include <so_5/all.hpp>
+
+#include <memory>
+
+//
+// trace_observer_agent_t
+//
+// Passes state changes of philosophers to observers. Receives
+// the same messages as trace_maker_t.
+//
+class trace_observer_agent_t final : public so_5::agent_t
+{
+	struct tick_t final : public so_5::signal_t {};
+
+public :
+	trace_observer_agent_t(
+		context_t ctx,
+		trace::observers_t observers,
+		std::chrono::steady_clock::duration tick_period )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_observers{ std::move(observers) }
+		,	m_tick_period{ tick_period }
+	{}
+
+	void so_define_agent() override
+	{
+		so_subscribe( trace_maker_t::make_mbox( so_environment() ) )
+			.event( [this]( mhood_t<trace::state_changed_t> cmd ) {
+					for( auto & o : m_observers )
+						o->on_state_changed( cmd->m_index, cmd->m_state, cmd->m_when );
+				} );
+
+		so_subscribe_self().event( [this]( mhood_t<tick_t> ) {
+				const auto now = std::chrono::steady_clock::now();
+				for( auto & o : m_observers )
+					o->on_tick( now );
+			} );
+	}
+
+	void so_evt_start() override
+	{
+		m_timer = so_5::send_periodic< tick_t >( *this,
+				m_tick_period, m_tick_period );
+	}
+
+	void so_evt_finish() override
+	{
+		const auto now = std::chrono::steady_clock::now();
+		for( auto & o : m_observers )
+			o->on_finish( now );
+	}
+
+private :
+	const trace::observers_t m_observers;
+	const std::chrono::steady_clock::duration m_tick_period;
+
+	so_5::timer_id_t m_timer;
+};
+
+// Adds an agent for observers turned on from the command line.
+inline void make_trace_observers(
+	so_5::coop_t & coop,
+	so_5::disp_binder_shptr_t binder,
+	const names_holder_t & names,
+	const trace::observers_params_t & params )
+{
+	auto observers = params.make( names );
+	if( !observers.empty() )
+		coop.make_agent_with_binder< trace_observer_agent_t >(
+				std::move(binder),
+				std::move(observers),
+				params.tick_period() );
+}
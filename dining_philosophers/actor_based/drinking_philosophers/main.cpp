@@ -0,0 +1,502 @@
+#include <dining_philosophers/common/conflict_graph.hpp>
+#include <dining_philosophers/common/fork_messages.hpp>
+#include <dining_philosophers/common/random_generator.hpp>
+#include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+
+#include <so_5/all.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+
+//
+// Drinking philosophers: every process needs an arbitrary subset of
+// shared resources (see conflict_graph_t).
+//
+// Two strategies are supported:
+// - ordered: every process takes its resources one by one in ascending
+//   order of their indexes (like no_waiter_dijkstra). Every resource is
+//   an agent with a queue of waiting processes;
+// - waiter: a process asks the waiter for all its resources at once.
+//
+
+enum class strategy_t
+{
+	ordered,
+	waiter
+};
+
+strategy_t strategy_from_string( const std::string & name )
+{
+	if( "ordered" == name ) return strategy_t::ordered;
+	if( "waiter" == name ) return strategy_t::waiter;
+
+	throw std::invalid_argument( "unknown strategy: " + name );
+}
+
+const char * to_string( strategy_t strategy )
+{
+	return strategy_t::ordered == strategy ? "ordered" : "waiter";
+}
+
+// Request for all resources of a process.
+struct acquire_t final : public so_5::message_t
+{
+	const std::size_t m_process_index;
+
+	explicit acquire_t( std::size_t process_index )
+		:	m_process_index{ process_index }
+	{}
+};
+
+// Return of all resources of a process.
+struct release_t final : public so_5::message_t
+{
+	const std::size_t m_process_index;
+
+	explicit release_t( std::size_t process_index )
+		:	m_process_index{ process_index }
+	{}
+};
+
+// All requested resources are given to the process.
+struct granted_t : public so_5::signal_t {};
+
+// Notification about the completion of a process.
+struct process_done_t final : public so_5::message_t
+{
+	const std::size_t m_process_index;
+	const unsigned int m_drinks;
+	// Time of waiting for resources for all drinks.
+	const std::chrono::steady_clock::duration m_waiting;
+	const std::chrono::steady_clock::duration m_max_waiting;
+
+	process_done_t(
+		std::size_t process_index,
+		unsigned int drinks,
+		std::chrono::steady_clock::duration waiting,
+		std::chrono::steady_clock::duration max_waiting )
+		:	m_process_index{ process_index }
+		,	m_drinks{ drinks }
+		,	m_waiting{ waiting }
+		,	m_max_waiting{ max_waiting }
+	{}
+};
+
+// A shared resource for the ordered strategy.
+// A queue of processes is maintained in taken state.
+class resource_t final : public so_5::agent_t
+{
+public :
+	resource_t( context_t ctx, const reply_table_t & replies )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_replies{ replies }
+	{}
+
+	void so_define_agent() override
+	{
+		this >>= st_free;
+
+		st_free
+			.event( [this]( mhood_t<take_t> cmd ) {
+					this >>= st_taken;
+					so_5::send< taken_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
+				} );
+
+		st_taken
+			.event( [this]( mhood_t<take_t> cmd ) {
+					m_queue.push_back( cmd->m_philosopher_index );
+				} )
+			.event( [this]( mhood_t<put_t> ) {
+					if( m_queue.empty() )
+						this >>= st_free;
+					else
+					{
+						const auto who = m_queue.front();
+						m_queue.pop_front();
+						so_5::send< taken_t >( m_replies.reply_mbox( who ) );
+					}
+				} );
+	}
+
+private :
+	const state_t st_free{ this, "free" };
+	const state_t st_taken{ this, "taken" };
+
+	const reply_table_t & m_replies;
+
+	std::deque< std::size_t > m_queue;
+};
+
+// The owner of all resources for the waiter strategy.
+//
+// Requests are handled in FIFO order, but a request can overtake
+// the previous ones if it doesn't need resources of them. So processes
+// those need other resources don't wait for a process with a "hot"
+// resource, and that process isn't starved by later requests.
+class waiter_t final : public so_5::agent_t
+{
+public :
+	waiter_t(
+		context_t ctx,
+		const conflict_graph_t & graph,
+		const reply_table_t & replies )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_graph{ graph }
+		,	m_replies{ replies }
+		,	m_taken( graph.m_resources_count, false )
+		,	m_reserved( graph.m_resources_count, false )
+	{}
+
+	void so_define_agent() override
+	{
+		so_subscribe_self()
+			.event( [this]( mhood_t<acquire_t> cmd ) {
+					m_queue.push_back( cmd->m_process_index );
+					try_grant();
+				} )
+			.event( [this]( mhood_t<release_t> cmd ) {
+					for( const auto r : m_graph.m_needs[ cmd->m_process_index ] )
+						m_taken[ r ] = false;
+					try_grant();
+				} );
+	}
+
+private :
+	const conflict_graph_t & m_graph;
+	const reply_table_t & m_replies;
+
+	std::vector< bool > m_taken;
+	// Resources needed by processes those were skipped during the current
+	// scan of the queue. They can't be given to the next processes.
+	std::vector< bool > m_reserved;
+
+	std::deque< std::size_t > m_queue;
+
+	void try_grant()
+	{
+		std::fill( m_reserved.begin(), m_reserved.end(), false );
+
+		for( auto it = m_queue.begin(); it != m_queue.end(); )
+		{
+			const auto & needs = m_graph.m_needs[ *it ];
+			const bool available = std::none_of( needs.begin(), needs.end(),
+					[this]( auto r ) { return m_taken[ r ] || m_reserved[ r ]; } );
+
+			if( available )
+			{
+				for( const auto r : needs )
+					m_taken[ r ] = true;
+				so_5::send< granted_t >( m_replies.reply_mbox( *it ) );
+				it = m_queue.erase( it );
+			}
+			else
+			{
+				for( const auto r : needs )
+					m_reserved[ r ] = true;
+				++it;
+			}
+		}
+	}
+};
+
+class process_t final
+	: public so_5::agent_t
+	, private random_pause_generator_t
+{
+	struct stop_thinking_t : public so_5::signal_t {};
+	struct stop_drinking_t : public so_5::signal_t {};
+
+public :
+	// For the ordered strategy resources should be in ascending order of
+	// their indexes. For the waiter strategy there should be just
+	// the mbox of the waiter.
+	process_t(
+		context_t ctx,
+		std::size_t index,
+		strategy_t strategy,
+		std::vector< so_5::mbox_t > targets,
+		unsigned int drinks_count,
+		so_5::mbox_t results )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_index{ index }
+		,	m_strategy{ strategy }
+		,	m_targets{ std::move(targets) }
+		,	m_drinks_count{ drinks_count }
+		,	m_results{ std::move(results) }
+	{}
+
+	void so_define_agent() override
+	{
+		st_thinking
+			.event( [this]( mhood_t<stop_thinking_t> ) {
+					this >>= st_waiting;
+					m_waiting_since = std::chrono::steady_clock::now();
+					m_taken = 0u;
+					if( strategy_t::ordered == m_strategy )
+						so_5::send< take_t >( m_targets.front(), m_index );
+					else
+						so_5::send< acquire_t >( m_targets.front(), m_index );
+				} );
+
+		st_waiting
+			.event( [this]( mhood_t<taken_t> ) {
+					++m_taken;
+					if( m_taken == m_targets.size() )
+						this >>= st_drinking;
+					else
+						so_5::send< take_t >( m_targets[ m_taken ], m_index );
+				} )
+			.event( [this]( mhood_t<granted_t> ) {
+					this >>= st_drinking;
+				} );
+
+		st_drinking
+			.on_enter( [this] {
+					const auto waiting =
+							std::chrono::steady_clock::now() - m_waiting_since;
+					m_waiting += waiting;
+					m_max_waiting = std::max( m_max_waiting, waiting );
+
+					so_5::send_delayed< stop_drinking_t >( *this, eat_pause() );
+				} )
+			.event( [this]( mhood_t<stop_drinking_t> ) {
+					if( strategy_t::ordered == m_strategy )
+						for( const auto & r : m_targets )
+							so_5::send< put_t >( r );
+					else
+						so_5::send< release_t >( m_targets.front(), m_index );
+
+					++m_drinks;
+					if( m_drinks_count == m_drinks )
+						this >>= st_done;
+					else
+						think();
+				} );
+
+		st_done
+			.on_enter( [this] {
+					so_5::send< process_done_t >( m_results,
+							m_index, m_drinks, m_waiting, m_max_waiting );
+				} );
+	}
+
+	void so_evt_start() override
+	{
+		think();
+	}
+
+private :
+	state_t st_thinking{ this, "thinking" };
+	state_t st_waiting{ this, "waiting" };
+	state_t st_drinking{ this, "drinking" };
+	state_t st_done{ this, "done" };
+
+	const std::size_t m_index;
+	const strategy_t m_strategy;
+	const std::vector< so_5::mbox_t > m_targets;
+	const unsigned int m_drinks_count;
+	const so_5::mbox_t m_results;
+
+	// Count of taken resources for the ordered strategy.
+	std::size_t m_taken{};
+
+	unsigned int m_drinks{};
+	std::chrono::steady_clock::time_point m_waiting_since;
+	std::chrono::steady_clock::duration m_waiting{};
+	std::chrono::steady_clock::duration m_max_waiting{};
+
+	void think()
+	{
+		this >>= st_thinking;
+		so_5::send_delayed< stop_thinking_t >(
+				*this, think_pause( thinking_type_t::normal ) );
+	}
+};
+
+struct run_result_t
+{
+	unsigned long long m_drinks{};
+	std::chrono::steady_clock::duration m_waiting{};
+	std::chrono::steady_clock::duration m_max_waiting{};
+};
+
+// Collects results of all processes and stops the environment.
+class results_collector_t final : public so_5::agent_t
+{
+public :
+	results_collector_t(
+		context_t ctx,
+		std::size_t processes_count,
+		run_result_t & result )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_processes_count{ processes_count }
+		,	m_result{ result }
+	{
+		so_subscribe_self().event( [this]( mhood_t<process_done_t> cmd ) {
+				m_result.m_drinks += cmd->m_drinks;
+				m_result.m_waiting += cmd->m_waiting;
+				m_result.m_max_waiting =
+						std::max( m_result.m_max_waiting, cmd->m_max_waiting );
+
+				++m_completed;
+				if( m_completed == m_processes_count )
+					so_environment().stop();
+			} );
+	}
+
+private :
+	const std::size_t m_processes_count;
+	run_result_t & m_result;
+	std::size_t m_completed{};
+};
+
+void run_simulation(
+	so_5::environment_t & env,
+	const conflict_graph_t & graph,
+	strategy_t strategy,
+	unsigned int drinks_count,
+	run_result_t & result )
+{
+	env.introduce_coop( [&]( so_5::coop_t & coop ) {
+		const auto count = graph.processes_count();
+
+		// Mboxes of processes for replies.
+		auto * replies = coop.take_under_control(
+				std::make_unique< reply_table_t >( count ) );
+
+		auto * collector = coop.make_agent< results_collector_t >(
+				count, result );
+
+		std::vector< so_5::mbox_t > resources;
+		so_5::mbox_t waiter;
+		if( strategy_t::ordered == strategy )
+			for( std::size_t r{}; r != graph.m_resources_count; ++r )
+				resources.push_back(
+						coop.make_agent< resource_t >( *replies )->so_direct_mbox() );
+		else
+			waiter = coop.make_agent< waiter_t >( graph, *replies )->so_direct_mbox();
+
+		for( std::size_t i{}; i != count; ++i )
+		{
+			std::vector< so_5::mbox_t > targets;
+			if( strategy_t::ordered == strategy )
+				for( const auto r : graph.m_needs[ i ] )
+					targets.push_back( resources[ r ] );
+			else
+				targets.push_back( waiter );
+
+			auto * process = coop.make_agent< process_t >(
+					i,
+					strategy,
+					std::move(targets),
+					drinks_count,
+					collector->so_direct_mbox() );
+			replies->register_philosopher( i, process->so_direct_mbox() );
+		}
+	});
+}
+
+void run_and_report(
+	const std::string & graph_name,
+	const conflict_graph_t & graph,
+	strategy_t strategy,
+	unsigned int drinks_count )
+{
+	run_result_t result;
+
+	const auto started_at = std::chrono::steady_clock::now();
+	so_5::launch( [&]( so_5::environment_t & env ) {
+			run_simulation( env, graph, strategy, drinks_count, result );
+		} );
+	const auto elapsed = std::chrono::duration< double >(
+			std::chrono::steady_clock::now() - started_at ).count();
+
+	using ms_t = std::chrono::duration< double, std::milli >;
+	fmt::print( "graph: {:<10} strategy: {:<8} processes: {}, resources: {}, "
+			"drinks: {}, elapsed: {:.3f}s, drinks/s: {:.1f}, "
+			"waiting avg: {:.1f}ms, max: {:.1f}ms\n",
+			graph_name,
+			to_string( strategy ),
+			graph.processes_count(),
+			graph.m_resources_count,
+			result.m_drinks,
+			elapsed,
+			result.m_drinks / elapsed,
+			result.m_drinks ?
+					ms_t( result.m_waiting ).count() / result.m_drinks : 0.0,
+			ms_t( result.m_max_waiting ).count() );
+}
+
+conflict_graph_t make_graph(
+	const std::string & kind,
+	std::size_t processes,
+	std::size_t resources,
+	std::size_t k,
+	unsigned seed )
+{
+	if( "random" == kind )
+		return conflict_graph::make_random( processes, resources, k, seed );
+	if( "grid" == kind )
+		return conflict_graph::make_square_grid( processes );
+	if( "power_law" == kind )
+		return conflict_graph::make_power_law( processes, resources, k, seed );
+
+	throw std::invalid_argument( "unknown kind of graph: " + kind );
+}
+
+int main( int argc, char ** argv )
+{
+	try
+	{
+		const cmd_line_args_t args{ argc, argv };
+
+		// Generated graphs are tuned by `--processes COUNT`,
+		// `--resources COUNT`, `--k RESOURCES_PER_PROCESS` and
+		// `--seed VALUE` options. Grid graphs use only count of processes.
+		const auto processes = std::stoul( args.value_or( "--processes", "16" ) );
+		const auto resources = std::stoul( args.value_or( "--resources", "16" ) );
+		const auto k = std::stoul( args.value_or( "--k", "3" ) );
+		const auto seed = static_cast< unsigned >(
+				std::stoul( args.value_or( "--seed", "0" ) ) );
+		const auto drinks = static_cast< unsigned >( std::stoul(
+				args.value_or( "--drinks", std::to_string( default_meals_count ) ) ) );
+
+		if( args.has_flag( "--bench" ) )
+		{
+			// Every strategy on every kind of generated graphs.
+			for( const auto * kind : { "random", "grid", "power_law" } )
+			{
+				const auto graph = make_graph( kind, processes, resources, k, seed );
+				for( const auto strategy : { strategy_t::ordered, strategy_t::waiter } )
+					run_and_report( kind, graph, strategy, drinks );
+			}
+		}
+		else
+		{
+			// Graph can be loaded by `--graph FILE` or generated by
+			// `--generate random|grid|power_law`.
+			const auto file = args.value_of( "--graph" );
+			const auto kind = args.value_or( "--generate", "random" );
+			const auto graph = file ? conflict_graph::load( *file ) :
+					make_graph( kind, processes, resources, k, seed );
+
+			run_and_report( file ? *file : kind,
+					graph,
+					strategy_from_string( args.value_or( "--strategy", "ordered" ) ),
+					drinks );
+		}
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Error: " << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
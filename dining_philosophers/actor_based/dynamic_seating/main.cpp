@@ -0,0 +1,994 @@
+#include <dining_philosophers/common/fork_messages.hpp>
+#include <dining_philosophers/common/random_generator.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+
+#include <so_5/all.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <random>
+
+// Philosophers join and leave the table while the simulation is running.
+//
+// Every seat has its own coop. A new seat is inserted between two
+// existing seats with a new fork. The philosopher at the left side of
+// the new seat starts using the new fork as its right fork. When a seat
+// is removed the philosopher at the left side starts using the right fork
+// of the leaving seat.
+//
+// A philosopher changes its right fork only when it doesn't hold that
+// fork. And a philosopher leaves the table only when it doesn't hold
+// any fork.
+
+// The value for "there is no seat/fork".
+constexpr std::size_t no_index = std::numeric_limits< std::size_t >::max();
+
+// Table should not become too small.
+constexpr std::size_t min_seats = 3u;
+
+// How forks are managed.
+enum class strategy_t
+{
+	// Every fork is an agent (like in no_waiter_simple).
+	forks,
+	// All forks are managed by a waiter (like in waiter_with_queue).
+	waiter
+};
+
+strategy_t strategy_from_string( const std::string & name )
+{
+	if( "forks" == name ) return strategy_t::forks;
+	if( "waiter" == name ) return strategy_t::waiter;
+
+	throw std::invalid_argument( "unknown strategy: " + name );
+}
+
+// Philosopher should use another fork as the right one.
+struct change_right_fork_t
+{
+	so_5::mbox_t m_fork;
+};
+
+// Philosopher has switched to the new right fork.
+struct right_fork_changed_t
+{
+	std::size_t m_seat;
+};
+
+// Philosopher should leave the table.
+struct leave_table_t final : public so_5::signal_t {};
+
+// Philosopher has left the table. It doesn't hold any fork.
+struct seat_left_t
+{
+	std::size_t m_seat;
+};
+
+// Philosopher has started eating.
+struct meal_started_t
+{
+	std::size_t m_seat;
+	// Time between the end of normal thinking and the start of eating.
+	std::chrono::steady_clock::duration m_wait;
+};
+
+// Request to the waiter for a new seat at the right side of m_after.
+struct add_seat_t
+{
+	std::size_t m_after;
+	std::size_t m_seat;
+};
+
+// Reply from the waiter. New seat is ready for a philosopher.
+struct seat_added_t
+{
+	std::size_t m_after;
+	std::size_t m_seat;
+	so_5::mbox_t m_left_fork;
+	so_5::mbox_t m_right_fork;
+};
+
+// Notification for the waiter. Philosopher has left the seat.
+struct remove_seat_t
+{
+	std::size_t m_seat;
+};
+
+class seated_philosopher_t final
+	: public so_5::agent_t
+	, private random_pause_generator_t
+{
+	struct stop_thinking_t : public so_5::signal_t {};
+	struct stop_eating_t : public so_5::signal_t {};
+
+public :
+	seated_philosopher_t(
+		context_t ctx,
+		std::size_t index,
+		so_5::mbox_t left_fork,
+		so_5::mbox_t right_fork,
+		so_5::mbox_t manager )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_index{ index }
+		,	m_left_fork{ std::move( left_fork ) }
+		,	m_right_fork{ std::move( right_fork ) }
+		,	m_manager{ std::move( manager ) }
+	{}
+
+	void so_define_agent() override
+	{
+		// Changes of the seat can be received in any state.
+		st_seated
+			.event( &seated_philosopher_t::on_change_right_fork )
+			.event( &seated_philosopher_t::on_leave_table );
+
+		st_thinking
+			.event( [this](mhood_t<stop_thinking_t>) {
+				if( so_is_active_state( st_normal_thinking ) )
+					m_hungry_since = std::chrono::steady_clock::now();
+
+				this >>= st_wait_left;
+				so_5::send< take_t >( m_left_fork, m_index );
+			} );
+
+		st_wait_left
+			.event( [this](mhood_t<taken_t>) {
+				this >>= st_wait_right;
+				so_5::send< take_t >( m_right_fork, m_index );
+			} )
+			.event( [this](mhood_t<busy_t>) {
+				think( st_hungry_thinking );
+			} );
+
+		st_wait_right
+			.event( [this](mhood_t<taken_t>) {
+				this >>= st_eating;
+			} )
+			.event( [this](mhood_t<busy_t>) {
+				so_5::send< put_t >( m_left_fork );
+				think( st_hungry_thinking );
+			} );
+
+		st_eating
+			.on_enter( [this] {
+					so_5::send< meal_started_t >( m_manager,
+							m_index,
+							std::chrono::steady_clock::now() - m_hungry_since );
+					so_5::send_delayed< stop_eating_t >( *this, eat_pause() );
+				} )
+			.event( [this](mhood_t<stop_eating_t>) {
+				so_5::send< put_t >( m_right_fork );
+				so_5::send< put_t >( m_left_fork );
+
+				think( st_normal_thinking );
+			} );
+	}
+
+	void so_evt_start() override
+	{
+		think( st_normal_thinking );
+	}
+
+private :
+	state_t st_seated{ this, "seated" };
+
+	state_t st_thinking{ initial_substate_of{ st_seated }, "thinking" };
+	state_t st_normal_thinking{ initial_substate_of{ st_thinking }, "normal" };
+	state_t st_hungry_thinking{ substate_of{ st_thinking }, "hungry" };
+
+	state_t st_wait_left{ substate_of{ st_seated }, "wait_left" };
+	state_t st_wait_right{ substate_of{ st_seated }, "wait_right" };
+	state_t st_eating{ substate_of{ st_seated }, "eating" };
+
+	state_t st_left{ this, "left" };
+
+	const std::size_t m_index;
+
+	const so_5::mbox_t m_left_fork;
+	so_5::mbox_t m_right_fork;
+
+	// The right fork to be used after the release of the current one.
+	so_5::mbox_t m_new_right_fork;
+
+	const so_5::mbox_t m_manager;
+
+	bool m_leave_requested{ false };
+
+	std::chrono::steady_clock::time_point m_hungry_since;
+
+	void on_change_right_fork( mhood_t<change_right_fork_t> cmd )
+	{
+		m_new_right_fork = cmd->m_fork;
+
+		// The current right fork can be held or requested. In that case
+		// the change will be applied at the start of the next thinking.
+		if( !so_is_active_state( st_wait_right ) &&
+				!so_is_active_state( st_eating ) )
+			apply_right_fork_change();
+	}
+
+	void on_leave_table( mhood_t<leave_table_t> )
+	{
+		m_leave_requested = true;
+
+		// If there is an attempt to take forks then the philosopher will
+		// leave at the start of the next thinking.
+		if( so_is_active_state( st_thinking ) )
+			leave();
+	}
+
+	void apply_right_fork_change()
+	{
+		if( m_new_right_fork )
+		{
+			m_right_fork = std::move(m_new_right_fork);
+			m_new_right_fork = so_5::mbox_t{};
+			so_5::send< right_fork_changed_t >( m_manager, m_index );
+		}
+	}
+
+	void leave()
+	{
+		this >>= st_left;
+		so_5::send< seat_left_t >( m_manager, m_index );
+		so_deregister_agent_coop_normally();
+	}
+
+	void think( const state_t & target_st )
+	{
+		// The philosopher doesn't hold any fork at this point.
+		if( m_leave_requested )
+		{
+			leave();
+			return;
+		}
+
+		apply_right_fork_change();
+
+		this >>= target_st;
+		so_5::send_delayed< stop_thinking_t >(
+				*this,
+				think_pause( target_st == st_normal_thinking ?
+						thinking_type_t::normal : thinking_type_t::hungry ) );
+	}
+};
+
+class fork_t final : public so_5::agent_t
+{
+public :
+	fork_t( context_t ctx, const reply_table_t & replies )
+		:	so_5::agent_t( ctx )
+		,	m_replies{ replies }
+	{
+		this >>= st_free;
+
+		st_free.event( [this]( mhood_t<take_t> cmd )
+				{
+					this >>= st_taken;
+					so_5::send< taken_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
+				} );
+
+		st_taken.event( [this]( mhood_t<take_t> cmd )
+				{
+					so_5::send< busy_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
+				} )
+			.just_switch_to< put_t >( st_free );
+	}
+
+private :
+	const state_t st_free{ this };
+	const state_t st_taken{ this };
+
+	const reply_table_t & m_replies;
+};
+
+// An actor for representing a waiter for a table with dynamic seating.
+//
+// The waiter holds a table of seats. Every seat knows its left and right
+// forks. Every fork knows seats at its left and right sides.
+//
+// Changes of the table are applied by the waiter immediately. But a
+// philosopher switches to the new right fork only after the return of
+// the old one. A fork that isn't used by any seat anymore is dropped
+// after its return.
+//
+class waiter_t final : public so_5::agent_t
+{
+public :
+	waiter_t(
+		context_t ctx,
+		const reply_table_t & replies,
+		so_5::mbox_t manager,
+		std::size_t initial_seats,
+		std::size_t max_seats )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_replies{ replies }
+		,	m_manager{ std::move(manager) }
+		,	m_seats( max_seats )
+	{
+		for( std::size_t i{}; i != initial_seats; ++i )
+			m_forks.push_back( fork_info_t{ so_environment().create_mbox() } );
+
+		for( std::size_t i{}; i != initial_seats; ++i )
+		{
+			const auto right = (i + 1) % initial_seats;
+			m_seats[ i ] = seat_info_t{ i, right };
+			m_forks[ i ].m_right_seat = i;
+			m_forks[ right ].m_left_seat = i;
+		}
+	}
+
+	// Get mbox of fork with specified index.
+	const so_5::mbox_t & fork_mbox( std::size_t index ) const noexcept
+	{
+		return m_forks[ index ].m_mbox;
+	}
+
+	void so_define_agent() override
+	{
+		for( std::size_t i{}; i != m_forks.size(); ++i )
+			subscribe_fork( i );
+
+		so_subscribe_self()
+			.event( &waiter_t::on_add_seat )
+			.event( &waiter_t::on_remove_seat );
+	}
+
+private :
+	// Every "fork" can be in one on these states.
+	enum class fork_state_t
+	{
+		free,
+		taken,
+		reserved
+	};
+
+	struct fork_info_t
+	{
+		so_5::mbox_t m_mbox;
+		fork_state_t m_state{ fork_state_t::free };
+		// Who has taken or reserved the fork.
+		std::size_t m_holder{ no_index };
+		// Seat that uses this fork as the right one.
+		std::size_t m_left_seat{ no_index };
+		// Seat that uses this fork as the left one.
+		std::size_t m_right_seat{ no_index };
+	};
+
+	struct seat_info_t
+	{
+		std::size_t m_left_fork{ no_index };
+		std::size_t m_right_fork{ no_index };
+	};
+
+	// Mboxes of philosophers for replies.
+	const reply_table_t & m_replies;
+
+	// Mbox of the manager of the table.
+	const so_5::mbox_t m_manager;
+
+	// Info about seats. Index of a seat is the index of a philosopher.
+	std::vector< seat_info_t > m_seats;
+
+	// Info about forks. Forks are never reused, so this vector only grows.
+	std::vector< fork_info_t > m_forks;
+
+	// Queue for waiting philosophers. Every philisopher is identified by index.
+	std::vector< std::size_t > m_wait_queue;
+
+	void subscribe_fork( std::size_t i )
+	{
+		so_subscribe( fork_mbox( i ) )
+			.event( [i, this]( mhood_t<take_t> cmd ) {
+					on_take_fork( std::move(cmd), i );
+				} )
+			.event( [i, this]( mhood_t<put_t> ) {
+					on_put_fork( i );
+				} );
+	}
+
+	void on_take_fork( mhood_t<take_t> cmd, std::size_t fork_index )
+	{
+		if( fork_index == m_seats[ cmd->m_philosopher_index ].m_left_fork )
+			handle_take_left_fork( std::move(cmd) );
+		else
+			handle_take_right_fork( std::move(cmd), fork_index );
+	}
+
+	void on_put_fork( std::size_t fork_index )
+	{
+		auto & fork = m_forks[ fork_index ];
+		fork.m_state = fork_state_t::free;
+		fork.m_holder = no_index;
+
+		drop_if_unused( fork_index );
+	}
+
+	void on_add_seat( mhood_t<add_seat_t> cmd )
+	{
+		const auto left_neighbor = cmd->m_after;
+		const auto seat = cmd->m_seat;
+
+		const auto new_fork = m_forks.size();
+		m_forks.push_back( fork_info_t{ so_environment().create_mbox() } );
+		subscribe_fork( new_fork );
+
+		const auto right_fork = m_seats[ left_neighbor ].m_right_fork;
+		change_right_fork( left_neighbor, new_fork );
+
+		m_seats[ seat ] = seat_info_t{ new_fork, right_fork };
+		m_forks[ new_fork ].m_right_seat = seat;
+		m_forks[ right_fork ].m_left_seat = seat;
+
+		so_5::send< seat_added_t >( m_manager,
+				left_neighbor,
+				seat,
+				fork_mbox( new_fork ),
+				fork_mbox( right_fork ) );
+	}
+
+	void on_remove_seat( mhood_t<remove_seat_t> cmd )
+	{
+		// The philosopher has already left the table and doesn't hold
+		// any fork. But it can still be in the wait queue.
+		const auto seat = cmd->m_seat;
+		m_wait_queue.erase(
+				std::remove( m_wait_queue.begin(), m_wait_queue.end(), seat ),
+				m_wait_queue.end() );
+
+		const auto left_fork = m_seats[ seat ].m_left_fork;
+		const auto right_fork = m_seats[ seat ].m_right_fork;
+		m_forks[ left_fork ].m_right_seat = no_index;
+		m_forks[ right_fork ].m_left_seat = no_index;
+		m_seats[ seat ] = seat_info_t{};
+
+		// The left neighbor should use our right fork instead of our left fork.
+		change_right_fork( m_forks[ left_fork ].m_left_seat, right_fork );
+	}
+
+	void change_right_fork( std::size_t seat, std::size_t fork_index )
+	{
+		auto & info = m_seats[ seat ];
+		const auto old_fork = std::exchange( info.m_right_fork, fork_index );
+		m_forks[ old_fork ].m_left_seat = no_index;
+		m_forks[ fork_index ].m_left_seat = seat;
+
+		// The old fork can still be held by the philosopher. In that case
+		// it will be dropped after the return.
+		drop_if_unused( old_fork );
+
+		// If the philosopher already waits for the old right fork the change
+		// will be applied after the return of the old fork. Otherwise
+		// this message will be received before the reply to the next 'take'.
+		so_5::send< change_right_fork_t >(
+				m_replies.reply_mbox( seat ), fork_mbox( fork_index ) );
+	}
+
+	void drop_if_unused( std::size_t fork_index )
+	{
+		auto & fork = m_forks[ fork_index ];
+		if( fork.m_mbox &&
+				fork_state_t::free == fork.m_state &&
+				no_index == fork.m_left_seat &&
+				no_index == fork.m_right_seat )
+		{
+			so_drop_subscription_for_all_states< take_t >( fork.m_mbox );
+			so_drop_subscription_for_all_states< put_t >( fork.m_mbox );
+			fork.m_mbox = so_5::mbox_t{};
+		}
+	}
+
+	void handle_take_left_fork( mhood_t<take_t> cmd )
+	{
+		const auto seat = cmd->m_philosopher_index;
+		auto & left_fork = m_forks[ m_seats[ seat ].m_left_fork ];
+		auto & right_fork = m_forks[ m_seats[ seat ].m_right_fork ];
+
+		// Philopsoher can eat only if both fork are free now.
+		bool can_eat =
+				(fork_state_t::free == left_fork.m_state) &&
+				(fork_state_t::free == right_fork.m_state);
+
+		if( can_eat )
+		{
+			// Both forks are free. But we should check the presence of
+			// neighbors in wait queue.
+			const auto left_neighbor = left_fork.m_left_seat;
+			const auto right_neighbor = right_fork.m_right_seat;
+
+			for( auto it = m_wait_queue.begin(); it != m_wait_queue.end(); ++it )
+			{
+				if( seat == *it )
+				{
+					// We found ourselves before our neighbors.
+					m_wait_queue.erase( it );
+					break;
+				}
+				else if( left_neighbor == *it || right_neighbor == *it )
+				{
+					// There is some neighbor before us in the queue.
+					can_eat = false;
+					break;
+				}
+			}
+		}
+
+		if( can_eat )
+		{
+			left_fork.m_state = fork_state_t::taken;
+			left_fork.m_holder = seat;
+			right_fork.m_state = fork_state_t::reserved;
+			right_fork.m_holder = seat;
+			so_5::send< taken_t >( m_replies.reply_mbox( seat ) );
+		}
+		else
+		{
+			if( m_wait_queue.end() == std::find(
+					m_wait_queue.begin(), m_wait_queue.end(), seat ) )
+				m_wait_queue.push_back( seat );
+
+			so_5::send< busy_t >( m_replies.reply_mbox( seat ) );
+		}
+	}
+
+	void handle_take_right_fork( mhood_t<take_t> cmd, std::size_t fork_index )
+	{
+		auto & fork = m_forks[ fork_index ];
+		if( fork_state_t::reserved != fork.m_state ||
+				cmd->m_philosopher_index != fork.m_holder )
+			throw std::runtime_error(
+					fmt::format( "unexpected state for right fork, state: {},"
+							" fork_index: {}, philosopher_index: {}",
+							static_cast<int>(fork.m_state),
+							fork_index,
+							cmd->m_philosopher_index ) );
+
+		fork.m_state = fork_state_t::taken;
+		so_5::send< taken_t >(
+				m_replies.reply_mbox( cmd->m_philosopher_index ) );
+	}
+};
+
+// An actor that changes the table during the simulation and collects
+// statistics about meals.
+//
+// Only one change of the table is performed at a time. The next change
+// is started only when all participants have confirmed the previous one.
+//
+class table_manager_t final : public so_5::agent_t
+{
+	struct churn_t final : public so_5::signal_t {};
+	struct report_t final : public so_5::signal_t {};
+	struct finish_t final : public so_5::signal_t {};
+
+public :
+	struct params_t
+	{
+		strategy_t m_strategy;
+		std::size_t m_initial_seats;
+		// Zero value means that the table isn't changed.
+		std::chrono::milliseconds m_churn_period;
+		std::chrono::milliseconds m_report_period;
+		std::chrono::seconds m_duration;
+	};
+
+	table_manager_t(
+		context_t ctx,
+		params_t params,
+		reply_table_t & replies,
+		// Waiter, its forks and mbox for replies from it.
+		// Used only for strategy_t::waiter.
+		so_5::mbox_t waiter,
+		std::vector< so_5::mbox_t > waiter_forks,
+		so_5::mbox_t waiter_replies )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_params{ std::move(params) }
+		,	m_replies{ replies }
+		,	m_waiter{ std::move(waiter) }
+		,	m_waiter_forks{ std::move(waiter_forks) }
+		,	m_waiter_replies{ std::move(waiter_replies) }
+		,	m_seats( max_seats( m_params ) )
+	{}
+
+	// Seats are never reused. So the count of seats depends on
+	// the count of changes.
+	static std::size_t max_seats( const params_t & params )
+	{
+		std::size_t changes{};
+		if( params.m_churn_period.count() )
+			changes = static_cast< std::size_t >(
+					std::chrono::milliseconds{ params.m_duration }
+							/ params.m_churn_period );
+
+		return params.m_initial_seats + changes + 1u;
+	}
+
+	void so_define_agent() override
+	{
+		so_subscribe_self()
+			.event( &table_manager_t::on_churn )
+			.event( &table_manager_t::on_report )
+			.event( &table_manager_t::on_finish )
+			.event( &table_manager_t::on_meal_started )
+			.event( &table_manager_t::on_right_fork_changed )
+			.event( &table_manager_t::on_seat_left );
+
+		if( m_waiter_replies )
+			so_subscribe( m_waiter_replies )
+				.event( &table_manager_t::on_seat_added );
+	}
+
+	void so_evt_start() override
+	{
+		create_initial_seats();
+
+		m_started_at = m_period_started_at = std::chrono::steady_clock::now();
+
+		m_report_timer = so_5::send_periodic< report_t >( *this,
+				m_params.m_report_period, m_params.m_report_period );
+		if( m_params.m_churn_period.count() )
+			m_churn_timer = so_5::send_periodic< churn_t >( *this,
+					m_params.m_churn_period, m_params.m_churn_period );
+
+		so_5::send_delayed< finish_t >( *this, m_params.m_duration );
+	}
+
+private :
+	struct seat_info_t
+	{
+		so_5::mbox_t m_philosopher;
+		// Forks are known only for strategy_t::forks.
+		so_5::mbox_t m_left_fork;
+		so_5::mbox_t m_right_fork;
+	};
+
+	// Statistics for a period of time.
+	struct stats_t
+	{
+		std::size_t m_meals{};
+		std::chrono::steady_clock::duration m_total_wait{};
+		std::chrono::steady_clock::duration m_max_wait{};
+		std::size_t m_changes{};
+	};
+
+	const params_t m_params;
+
+	// Mboxes of philosophers for replies from forks or waiter.
+	reply_table_t & m_replies;
+
+	const so_5::mbox_t m_waiter;
+	const std::vector< so_5::mbox_t > m_waiter_forks;
+	const so_5::mbox_t m_waiter_replies;
+
+	// Info about seats. Index of a seat is the index of a philosopher.
+	std::vector< seat_info_t > m_seats;
+	std::size_t m_next_seat{};
+
+	// Seats in order around the table.
+	std::vector< std::size_t > m_ring;
+
+	// Participants of the current change of the table.
+	// Philosopher that has to switch to the new right fork.
+	std::size_t m_switching_seat{ no_index };
+	// Philosopher that has to leave the table after m_switching_seat.
+	std::size_t m_seat_to_leave{ no_index };
+	// Philosopher that is leaving the table.
+	std::size_t m_leaving_seat{ no_index };
+	// The waiter is preparing a new seat.
+	bool m_waiter_busy{ false };
+
+	std::mt19937 m_random_engine{ std::random_device{}() };
+
+	so_5::timer_id_t m_report_timer;
+	so_5::timer_id_t m_churn_timer;
+
+	std::chrono::steady_clock::time_point m_started_at;
+	std::chrono::steady_clock::time_point m_period_started_at;
+	stats_t m_period_stats;
+	stats_t m_total_stats;
+
+	bool change_in_progress() const noexcept
+	{
+		return no_index != m_switching_seat || no_index != m_leaving_seat ||
+				m_waiter_busy;
+	}
+
+	void change_completed()
+	{
+		++m_period_stats.m_changes;
+		++m_total_stats.m_changes;
+	}
+
+	std::size_t random_position()
+	{
+		return std::uniform_int_distribution< std::size_t >{
+				0u, m_ring.size() - 1u }( m_random_engine );
+	}
+
+	// Makes a philosopher for a new seat.
+	void make_philosopher(
+		so_5::coop_t & coop,
+		std::size_t seat,
+		so_5::mbox_t left_fork,
+		so_5::mbox_t right_fork )
+	{
+		auto * philosopher = coop.make_agent< seated_philosopher_t >(
+				seat, left_fork, right_fork, so_direct_mbox() );
+		m_replies.register_philosopher( seat, philosopher->so_direct_mbox() );
+
+		m_seats[ seat ] = seat_info_t{
+				philosopher->so_direct_mbox(),
+				std::move(left_fork),
+				std::move(right_fork) };
+	}
+
+	void create_initial_seats()
+	{
+		const auto count = m_params.m_initial_seats;
+
+		// Every seat has its own coop. But all forks have to be created
+		// before philosophers.
+		std::vector< so_5::coop_unique_holder_t > coops;
+		std::vector< so_5::mbox_t > forks;
+		for( std::size_t i{}; i != count; ++i )
+		{
+			coops.push_back( so_environment().make_coop( so_coop() ) );
+			if( strategy_t::forks == m_params.m_strategy )
+				forks.push_back(
+						coops.back()->make_agent< fork_t >( m_replies )
+								->so_direct_mbox() );
+			else
+				forks.push_back( m_waiter_forks[ i ] );
+		}
+
+		for( std::size_t i{}; i != count; ++i )
+		{
+			make_philosopher( *coops[ i ], i, forks[ i ], forks[ (i + 1) % count ] );
+			m_ring.push_back( i );
+		}
+		m_next_seat = count;
+
+		for( auto & coop : coops )
+			so_environment().register_coop( std::move(coop) );
+	}
+
+	void on_churn( mhood_t<churn_t> )
+	{
+		if( change_in_progress() )
+			return;
+
+		const bool can_insert = m_next_seat != m_seats.size();
+		const bool can_remove = m_ring.size() > min_seats;
+		if( can_insert &&
+				(!can_remove || std::bernoulli_distribution{}( m_random_engine )) )
+			insert_seat( random_position() );
+		else if( can_remove )
+			remove_seat( random_position() );
+	}
+
+	void insert_seat( std::size_t position )
+	{
+		const auto left_neighbor = m_ring[ position ];
+		const auto seat = m_next_seat++;
+
+		if( strategy_t::waiter == m_params.m_strategy )
+		{
+			// The waiter will reply by seat_added_t.
+			m_waiter_busy = true;
+			so_5::send< add_seat_t >( m_waiter, left_neighbor, seat );
+			return;
+		}
+
+		so_5::mbox_t new_fork;
+		so_5::introduce_child_coop( *this, [&]( so_5::coop_t & coop ) {
+				new_fork = coop.make_agent< fork_t >( m_replies )->so_direct_mbox();
+				make_philosopher( coop, seat,
+						new_fork, m_seats[ left_neighbor ].m_right_fork );
+			} );
+		m_ring.insert( m_ring.begin() + position + 1, seat );
+
+		// The new fork is registered. The left neighbor can use it now.
+		m_seats[ left_neighbor ].m_right_fork = new_fork;
+		m_switching_seat = left_neighbor;
+		so_5::send< change_right_fork_t >(
+				m_seats[ left_neighbor ].m_philosopher, new_fork );
+	}
+
+	void remove_seat( std::size_t position )
+	{
+		const auto seat = m_ring[ position ];
+		const auto left_neighbor =
+				m_ring[ (m_ring.size() + position - 1u) % m_ring.size() ];
+
+		if( strategy_t::waiter == m_params.m_strategy )
+		{
+			// The waiter will be informed when the philosopher will leave.
+			m_leaving_seat = seat;
+			so_5::send< leave_table_t >( m_seats[ seat ].m_philosopher );
+			return;
+		}
+
+		// The left fork of the leaving seat is destroyed with its coop.
+		// So the left neighbor should stop using it before that.
+		m_seats[ left_neighbor ].m_right_fork = m_seats[ seat ].m_right_fork;
+		m_switching_seat = left_neighbor;
+		m_seat_to_leave = seat;
+		so_5::send< change_right_fork_t >(
+				m_seats[ left_neighbor ].m_philosopher,
+				m_seats[ seat ].m_right_fork );
+	}
+
+	void on_right_fork_changed( mhood_t<right_fork_changed_t> cmd )
+	{
+		// Changes made by the waiter aren't tracked here.
+		if( cmd->m_seat != m_switching_seat )
+			return;
+
+		m_switching_seat = no_index;
+		if( no_index != m_seat_to_leave )
+		{
+			m_leaving_seat = std::exchange( m_seat_to_leave, no_index );
+			so_5::send< leave_table_t >( m_seats[ m_leaving_seat ].m_philosopher );
+		}
+		else
+			change_completed();
+	}
+
+	void on_seat_left( mhood_t<seat_left_t> cmd )
+	{
+		if( strategy_t::waiter == m_params.m_strategy )
+			so_5::send< remove_seat_t >( m_waiter, cmd->m_seat );
+
+		m_ring.erase( std::find( m_ring.begin(), m_ring.end(), cmd->m_seat ) );
+		m_seats[ cmd->m_seat ] = seat_info_t{};
+		m_leaving_seat = no_index;
+		change_completed();
+	}
+
+	void on_seat_added( mhood_t<seat_added_t> cmd )
+	{
+		so_5::introduce_child_coop( *this, [&]( so_5::coop_t & coop ) {
+				make_philosopher( coop, cmd->m_seat,
+						cmd->m_left_fork, cmd->m_right_fork );
+			} );
+		m_ring.insert(
+				std::find( m_ring.begin(), m_ring.end(), cmd->m_after ) + 1,
+				cmd->m_seat );
+
+		m_waiter_busy = false;
+		change_completed();
+	}
+
+	void on_meal_started( mhood_t<meal_started_t> cmd )
+	{
+		for( auto * stats : { &m_period_stats, &m_total_stats } )
+		{
+			++stats->m_meals;
+			stats->m_total_wait += cmd->m_wait;
+			stats->m_max_wait = std::max( stats->m_max_wait, cmd->m_wait );
+		}
+	}
+
+	void on_report( mhood_t<report_t> )
+	{
+		const auto now = std::chrono::steady_clock::now();
+		show_stats( "",
+				std::chrono::duration< double >( now - m_started_at ).count(),
+				now - m_period_started_at,
+				m_period_stats );
+
+		m_period_started_at = now;
+		m_period_stats = stats_t{};
+	}
+
+	void on_finish( mhood_t<finish_t> )
+	{
+		show_stats( "total ",
+				std::chrono::duration< double >(
+						m_params.m_duration ).count(),
+				std::chrono::steady_clock::now() - m_started_at,
+				m_total_stats );
+
+		so_environment().stop();
+	}
+
+	void show_stats(
+		const char * prefix,
+		double at,
+		std::chrono::steady_clock::duration period,
+		const stats_t & stats ) const
+	{
+		using ms_t = std::chrono::duration< double, std::milli >;
+
+		const double seconds = std::chrono::duration< double >( period ).count();
+		fmt::print( "{}{:>6.1f}s: seats: {:>3}, meals/s: {:>6.1f}, "
+				"avg wait: {:>6.1f}ms, max wait: {:>6.1f}ms, changes: {}\n",
+				prefix,
+				at,
+				m_ring.size(),
+				stats.m_meals / seconds,
+				stats.m_meals ?
+						ms_t( stats.m_total_wait ).count() / stats.m_meals : 0.0,
+				ms_t( stats.m_max_wait ).count(),
+				stats.m_changes );
+	}
+};
+
+void run_simulation(
+	so_5::environment_t & env,
+	table_manager_t::params_t params )
+{
+	env.introduce_coop( [&]( so_5::coop_t & coop ) {
+		const auto max_seats = table_manager_t::max_seats( params );
+
+		// Mboxes of philosophers for replies. Entries for new seats are
+		// registered before the start of new philosophers.
+		auto * replies = coop.take_under_control(
+				std::make_unique< reply_table_t >( max_seats ) );
+
+		so_5::mbox_t waiter_mbox;
+		std::vector< so_5::mbox_t > waiter_forks;
+		so_5::mbox_t waiter_replies;
+		if( strategy_t::waiter == params.m_strategy )
+		{
+			// The waiter is created before the manager. So a separate mbox
+			// is used for replies from the waiter to the manager.
+			waiter_replies = env.create_mbox();
+
+			auto * waiter = coop.make_agent< waiter_t >(
+					*replies, waiter_replies, params.m_initial_seats, max_seats );
+			waiter_mbox = waiter->so_direct_mbox();
+			for( std::size_t i{}; i != params.m_initial_seats; ++i )
+				waiter_forks.push_back( waiter->fork_mbox( i ) );
+		}
+
+		coop.make_agent< table_manager_t >(
+				params,
+				*replies,
+				waiter_mbox,
+				std::move(waiter_forks),
+				waiter_replies );
+	} );
+}
+
+int main( int argc, char ** argv )
+{
+	try
+	{
+		const cmd_line_args_t args{ argc, argv };
+
+		table_manager_t::params_t params{
+			// `--strategy forks|waiter`.
+			strategy_from_string( args.value_or( "--strategy", "forks" ) ),
+			// `--seats COUNT` is the count of seats at the start.
+			std::stoul( args.value_or( "--seats", "11" ) ),
+			// `--churn MILLISECONDS` is the period of changes of the table.
+			// Zero value turns the changes off.
+			std::chrono::milliseconds{ std::stoul( args.value_or( "--churn", "250" ) ) },
+			std::chrono::milliseconds{ 1000 },
+			// `--duration SECONDS` is the duration of the simulation.
+			std::chrono::seconds{ std::stoul( args.value_or( "--duration", "10" ) ) }
+		};
+
+		if( params.m_initial_seats < min_seats )
+			throw std::invalid_argument(
+					fmt::format( "at least {} seats are required", min_seats ) );
+
+		so_5::launch( [&]( so_5::environment_t & env ) {
+				run_simulation( env, params );
+			} );
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Error: " << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,587 @@
+#include <dining_philosophers/actor_based/common/philosopher.hpp>
+#include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/fork_bitset.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <thread>
+
+//
+// Hierarchical waiters for very large tables.
+//
+// The table is split into segments of consecutive seats. Every segment is
+// served by a leaf waiter that owns forks inside the segment. The first
+// fork of a segment is shared with the previous segment. Such boundary
+// forks are owned by inner waiters: a boundary fork between two leaves
+// belongs to their lowest common ancestor in a tree of waiters (the fork
+// between the last and the first segments belongs to the root).
+//
+// The owner leases a boundary fork to a leaf on demand. The leaf keeps
+// the lease until the owner recalls it because the other leaf needs
+// the fork. A lease that is granted to a waiting philosopher isn't given
+// back before the next attempt of that philosopher, so the fork can't
+// bounce between leaves without being used. So requests for interior forks never leave the leaf and
+// an inner waiter only handles leases of forks between its subtrees.
+//
+
+// Request for a lease of a boundary fork.
+struct lease_request_t final : public so_5::message_t
+{
+	const std::size_t m_fork;
+	const std::size_t m_leaf;
+
+	lease_request_t( std::size_t fork, std::size_t leaf )
+		:	m_fork{ fork }
+		,	m_leaf{ leaf }
+	{}
+};
+
+// The fork is leased to the leaf.
+struct lease_granted_t final : public so_5::message_t
+{
+	const std::size_t m_fork;
+
+	explicit lease_granted_t( std::size_t fork ) : m_fork{ fork } {}
+};
+
+// The fork should be returned to the owner as soon as it is free.
+struct lease_recall_t final : public so_5::message_t
+{
+	const std::size_t m_fork;
+
+	explicit lease_recall_t( std::size_t fork ) : m_fork{ fork } {}
+};
+
+// The fork is returned to the owner.
+struct lease_return_t final : public so_5::message_t
+{
+	const std::size_t m_fork;
+
+	explicit lease_return_t( std::size_t fork ) : m_fork{ fork } {}
+};
+
+// Counters of all waiters. Waiters work on different threads.
+struct counters_t
+{
+	std::atomic< std::uint64_t > m_takes{};
+	std::atomic< std::uint64_t > m_lease_requests{};
+	std::atomic< std::uint64_t > m_recalls{};
+};
+
+// A waiter that owns boundary forks between its subtrees.
+class inner_waiter_t final : public so_5::agent_t
+{
+public :
+	inner_waiter_t(
+		context_t ctx,
+		// Mboxes of leaf waiters.
+		const reply_table_t & leaves,
+		counters_t & counters )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_leaves{ leaves }
+		,	m_counters{ counters }
+	{}
+
+	// Should be called before the start of the agent.
+	void own( std::size_t fork )
+	{
+		m_forks.emplace( fork, lease_info_t{} );
+	}
+
+	void so_define_agent() override
+	{
+		so_subscribe_self()
+			.event( [this]( mhood_t<lease_request_t> cmd ) {
+					auto & info = m_forks.at( cmd->m_fork );
+					if( !info.m_holder )
+						grant( cmd->m_fork, info, cmd->m_leaf );
+					else if( *info.m_holder != cmd->m_leaf )
+					{
+						// Only two leaves share a fork, so there can be
+						// just one waiting leaf.
+						info.m_waiting = cmd->m_leaf;
+						if( !info.m_recall_sent )
+							recall( cmd->m_fork, info );
+					}
+				} )
+			.event( [this]( mhood_t<lease_return_t> cmd ) {
+					auto & info = m_forks.at( cmd->m_fork );
+					info.m_holder.reset();
+					info.m_recall_sent = false;
+					if( info.m_waiting )
+					{
+						grant( cmd->m_fork, info, *info.m_waiting );
+						info.m_waiting.reset();
+					}
+				} );
+	}
+
+private :
+	struct lease_info_t
+	{
+		std::optional< std::size_t > m_holder;
+		std::optional< std::size_t > m_waiting;
+		bool m_recall_sent{ false };
+	};
+
+	const reply_table_t & m_leaves;
+	counters_t & m_counters;
+
+	std::map< std::size_t, lease_info_t > m_forks;
+
+	void grant( std::size_t fork, lease_info_t & info, std::size_t leaf )
+	{
+		info.m_holder = leaf;
+		so_5::send< lease_granted_t >( m_leaves.reply_mbox( leaf ), fork );
+	}
+
+	void recall( std::size_t fork, lease_info_t & info )
+	{
+		info.m_recall_sent = true;
+		++m_counters.m_recalls;
+		so_5::send< lease_recall_t >( m_leaves.reply_mbox( *info.m_holder ), fork );
+	}
+};
+
+// A waiter for a segment of the table.
+//
+// Takes are handled like in waiter_with_queue: a philosopher gets the left
+// fork only if both forks are free and there is no neighbor before
+// him/her in the wait queue, the right fork is reserved till the next
+// request.
+//
+// Forks of the segment have local indexes from 0 to seats count (both
+// inclusive). Forks 0 and seats count are boundary forks: they are
+// available only while they are leased to the leaf.
+class leaf_waiter_t final : public so_5::agent_t
+{
+public :
+	leaf_waiter_t(
+		context_t ctx,
+		std::size_t index,
+		std::size_t first_seat,
+		std::size_t seats,
+		std::size_t table_size,
+		const reply_table_t & replies,
+		so_5::mbox_t first_fork_owner,
+		so_5::mbox_t last_fork_owner,
+		counters_t & counters )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_index{ index }
+		,	m_first_seat{ first_seat }
+		,	m_replies{ replies }
+		,	m_counters{ counters }
+		,	m_fork_states( seats + 1u )
+		,	m_boundaries{
+				boundary_t{ 0u, first_seat, 0u, std::move(first_fork_owner) },
+				boundary_t{ seats, (first_seat + seats) % table_size, seats - 1u,
+						std::move(last_fork_owner) } }
+	{
+		for( const auto & b : m_boundaries )
+			m_fork_states.set( b.m_local, fork_state_t::taken );
+
+		m_fork_mboxes.reserve( seats + 1u );
+		for( std::size_t i{}; i != seats + 1u; ++i )
+			m_fork_mboxes.push_back( so_environment().create_mbox() );
+	}
+
+	// Get mbox of fork with specified local index.
+	const so_5::mbox_t & fork_mbox( std::size_t index ) const noexcept
+	{
+		return m_fork_mboxes[ index ];
+	}
+
+	void so_define_agent() override
+	{
+		for( std::size_t i{}; i != m_fork_mboxes.size(); ++i )
+		{
+			so_subscribe( fork_mbox( i ) )
+				.event( [i, this]( mhood_t<take_t> cmd ) {
+						on_take_fork( cmd->m_philosopher_index - m_first_seat, i );
+					} )
+				.event( [i, this]( mhood_t<put_t> ) {
+						on_put_fork( i );
+					} );
+		}
+
+		so_subscribe_self()
+			.event( [this]( mhood_t<lease_granted_t> cmd ) {
+					auto & b = boundary( cmd->m_fork );
+					b.m_state = lease_state_t::held;
+					m_fork_states.set( b.m_local, fork_state_t::free );
+					// The lease was requested for the waiting philosopher.
+					// It's kept till the next attempt of that philosopher.
+					b.m_promised = m_wait_queue.end() != std::find(
+							m_wait_queue.begin(), m_wait_queue.end(),
+							b.m_philosopher );
+				} )
+			.event( [this]( mhood_t<lease_recall_t> cmd ) {
+					auto & b = boundary( cmd->m_fork );
+					if( !b.m_promised && m_fork_states.is_free( b.m_local ) )
+						give_back( b );
+					else
+						// Will be returned when the philosopher tries it
+						// or puts it.
+						b.m_recalled = true;
+				} );
+	}
+
+private :
+	enum class lease_state_t
+	{
+		absent,
+		requested,
+		held
+	};
+
+	struct boundary_t
+	{
+		std::size_t m_local;
+		std::size_t m_global;
+		// The only philosopher of the segment that uses the fork.
+		std::size_t m_philosopher;
+		so_5::mbox_t m_owner;
+		lease_state_t m_state{ lease_state_t::absent };
+		bool m_recalled{ false };
+		// The philosopher hasn't tried the fork since the lease was granted.
+		bool m_promised{ false };
+
+		boundary_t(
+			std::size_t local,
+			std::size_t global,
+			std::size_t philosopher,
+			so_5::mbox_t owner )
+			:	m_local{ local }
+			,	m_global{ global }
+			,	m_philosopher{ philosopher }
+			,	m_owner{ std::move(owner) }
+		{}
+	};
+
+	const std::size_t m_index;
+	const std::size_t m_first_seat;
+
+	// Mboxes of philosophers for replies.
+	const reply_table_t & m_replies;
+
+	counters_t & m_counters;
+
+	// Mboxes for "forks".
+	std::vector< so_5::mbox_t > m_fork_mboxes;
+
+	fork_bitset_t m_fork_states;
+
+	std::array< boundary_t, 2 > m_boundaries;
+
+	// Queue for waiting philosophers (local indexes).
+	std::vector< std::size_t > m_wait_queue;
+
+	boundary_t & boundary( std::size_t global_fork )
+	{
+		return m_boundaries[ 0 ].m_global == global_fork ?
+				m_boundaries[ 0 ] : m_boundaries[ 1 ];
+	}
+
+	boundary_t * find_boundary_by_local( std::size_t local_fork )
+	{
+		for( auto & b : m_boundaries )
+			if( b.m_local == local_fork )
+				return &b;
+		return nullptr;
+	}
+
+	void on_take_fork( std::size_t philosopher, std::size_t fork_index )
+	{
+		++m_counters.m_takes;
+
+		// Use the fact that the local index of left fork is always equal
+		// to the local index of the philosopher itself.
+		if( fork_index == philosopher )
+			handle_take_left_fork( philosopher );
+		else
+		{
+			// The right fork was reserved for that philosopher.
+			m_fork_states.set( fork_index, fork_state_t::taken );
+			so_5::send< taken_t >(
+					m_replies.reply_mbox( m_first_seat + philosopher ) );
+		}
+	}
+
+	void on_put_fork( std::size_t fork_index )
+	{
+		m_fork_states.set( fork_index, fork_state_t::free );
+
+		auto * b = find_boundary_by_local( fork_index );
+		if( b && b->m_recalled )
+			give_back( *b );
+	}
+
+	void handle_take_left_fork( std::size_t philosopher )
+	{
+		// The philosopher has tried leased forks, they can be given back
+		// if they are still free after that attempt.
+		for( auto & b : m_boundaries )
+			if( b.m_philosopher == philosopher )
+				b.m_promised = false;
+
+		const auto right_fork = philosopher + 1u;
+		bool can_eat = m_fork_states.can_eat( philosopher );
+		if( can_eat )
+		{
+			// Neighbors from other segments are not taken into account,
+			// leases are given to leaves in turn.
+			for( auto it = m_wait_queue.begin(); it != m_wait_queue.end(); ++it )
+			{
+				if( philosopher == *it )
+				{
+					m_wait_queue.erase( it );
+					break;
+				}
+				else if( philosopher == *it + 1u || *it == right_fork )
+				{
+					can_eat = false;
+					break;
+				}
+			}
+		}
+
+		const auto reply_mbox = m_replies.reply_mbox( m_first_seat + philosopher );
+		if( can_eat )
+		{
+			m_fork_states.set( philosopher, fork_state_t::taken );
+			m_fork_states.set( right_fork, fork_state_t::reserved );
+			so_5::send< taken_t >( reply_mbox );
+		}
+		else
+		{
+			if( m_wait_queue.end() == std::find(
+					m_wait_queue.begin(), m_wait_queue.end(), philosopher ) )
+				m_wait_queue.push_back( philosopher );
+
+			for( const auto fork : { philosopher, right_fork } )
+				if( auto * b = find_boundary_by_local( fork ) )
+				{
+					if( b->m_recalled && m_fork_states.is_free( b->m_local ) )
+						give_back( *b );
+					request_lease( *b );
+				}
+
+			so_5::send< busy_t >( reply_mbox );
+		}
+	}
+
+	void request_lease( boundary_t & b )
+	{
+		if( lease_state_t::absent == b.m_state )
+		{
+			b.m_state = lease_state_t::requested;
+			++m_counters.m_lease_requests;
+			so_5::send< lease_request_t >( b.m_owner, b.m_global, m_index );
+		}
+	}
+
+	void give_back( boundary_t & b )
+	{
+		b.m_state = lease_state_t::absent;
+		b.m_recalled = false;
+		b.m_promised = false;
+		m_fork_states.set( b.m_local, fork_state_t::taken );
+		so_5::send< lease_return_t >( b.m_owner, b.m_global );
+	}
+};
+
+struct tree_params_t
+{
+	std::size_t m_seats;
+	// Count of seats served by a leaf waiter.
+	std::size_t m_segment;
+	// Count of children of an inner waiter.
+	std::size_t m_branching;
+	int m_meals_count;
+	// Philosophers don't think and eat, only the cost of
+	// the coordination is measured.
+	bool m_zero_pauses;
+};
+
+struct tree_shape_t
+{
+	std::size_t m_leaves{};
+	std::size_t m_inner_waiters{};
+	std::size_t m_depth{};
+};
+
+// Creates all agents and returns the shape of the tree of waiters.
+template< typename Philosopher >
+tree_shape_t make_table(
+	so_5::coop_t & coop,
+	const tree_params_t & params,
+	counters_t & counters )
+{
+	tree_shape_t shape;
+	const auto seats = params.m_seats;
+	const auto segment = params.m_segment;
+	const auto branching = params.m_branching;
+	shape.m_leaves = (seats + segment - 1u) / segment;
+
+	// Mboxes of philosophers and leaf waiters for replies.
+	auto * replies = coop.take_under_control(
+			std::make_unique< reply_table_t >( seats ) );
+	auto * leaf_mboxes = coop.take_under_control(
+			std::make_unique< reply_table_t >( shape.m_leaves ) );
+
+	// Notification from the last completed philosopher.
+	auto * latch = coop.take_under_control(
+			std::make_unique< completion_latch_t >( coop.environment(), seats ) );
+	coop.make_agent< completion_watcher_t >( *latch );
+
+	// Inner waiters by levels. Level 1 is the parent of leaves.
+	std::vector< std::vector< inner_waiter_t * > > levels{ 1u };
+	for( std::size_t count = shape.m_leaves; count > 1u; )
+	{
+		count = (count + branching - 1u) / branching;
+		levels.emplace_back();
+		for( std::size_t i{}; i != count; ++i )
+			levels.back().push_back(
+					coop.make_agent< inner_waiter_t >( *leaf_mboxes, counters ) );
+		shape.m_inner_waiters += count;
+	}
+	shape.m_depth = levels.size() - 1u;
+
+	// The owner of the first fork of the leaf: the lowest common ancestor
+	// of that leaf and the previous one.
+	const auto owner_of = [&]( std::size_t leaf ) {
+		if( 0u == leaf )
+			return levels.back().front();
+
+		std::size_t level = 1u;
+		for( std::size_t span = branching;
+				(leaf - 1u) / span != leaf / span;
+				span *= branching )
+			++level;
+
+		std::size_t span = 1u;
+		for( std::size_t i{}; i != level; ++i )
+			span *= branching;
+		return levels[ level ][ leaf / span ];
+	};
+
+	for( std::size_t leaf{}; leaf != shape.m_leaves; ++leaf )
+		owner_of( leaf )->own( leaf * segment );
+
+	for( std::size_t leaf{}; leaf != shape.m_leaves; ++leaf )
+	{
+		const auto first_seat = leaf * segment;
+		const auto leaf_seats = std::min( segment, seats - first_seat );
+
+		auto * waiter = coop.make_agent< leaf_waiter_t >(
+				leaf,
+				first_seat,
+				leaf_seats,
+				seats,
+				*replies,
+				owner_of( leaf )->so_direct_mbox(),
+				owner_of( (leaf + 1u) % shape.m_leaves )->so_direct_mbox(),
+				counters );
+		leaf_mboxes->register_philosopher( leaf, waiter->so_direct_mbox() );
+
+		for( std::size_t j{}; j != leaf_seats; ++j )
+		{
+			auto * philosopher = coop.make_agent< Philosopher >(
+					first_seat + j,
+					waiter->fork_mbox( j ),
+					waiter->fork_mbox( j + 1u ),
+					params.m_meals_count,
+					backoff_policy_t::uniform,
+					philosopher_policies::completion_latch_notification_t{ *latch } );
+			replies->register_philosopher(
+					first_seat + j, philosopher->so_direct_mbox() );
+		}
+	}
+
+	return shape;
+}
+
+int main( int argc, char ** argv )
+{
+	try
+	{
+		const cmd_line_args_t args{ argc, argv };
+
+		// The size of the table and the shape of the tree can be set by
+		// `--seats COUNT`, `--segment SEATS_PER_LEAF` and
+		// `--branching CHILDREN_PER_WAITER` options. Pauses of philosophers
+		// are turned off by `--zero-pauses` flag.
+		const tree_params_t params{
+			std::stoul( args.value_or( "--seats", "1024" ) ),
+			std::stoul( args.value_or( "--segment", "64" ) ),
+			std::max( 2ul, std::stoul( args.value_or( "--branching", "4" ) ) ),
+			std::stoi( args.value_or( "--meals",
+					std::to_string( default_meals_count ) ) ),
+			args.has_flag( "--zero-pauses" )
+		};
+		if( 0u == params.m_segment || params.m_seats <= params.m_segment )
+			throw std::invalid_argument(
+					"there should be at least two segments" );
+
+		counters_t counters;
+		tree_shape_t shape;
+
+		const auto started_at = std::chrono::steady_clock::now();
+		so_5::launch( [&]( so_5::environment_t & env ) {
+				so_5::disp::thread_pool::bind_params_t bind_params;
+				bind_params.fifo( so_5::disp::thread_pool::fifo_t::individual );
+
+				env.introduce_coop(
+						so_5::disp::thread_pool::make_dispatcher( env,
+								std::max( 1u, std::thread::hardware_concurrency() ) )
+							.binder( bind_params ),
+						[&]( so_5::coop_t & coop ) {
+							// There is no trace_maker, so states aren't traced.
+							using namespace philosopher_policies;
+							if( params.m_zero_pauses )
+								shape = make_table< basic_philosopher_t<
+												no_tracing_t,
+												zero_pauses_t,
+												completion_latch_notification_t > >(
+										coop, params, counters );
+							else
+								shape = make_table< basic_philosopher_t<
+												no_tracing_t,
+												random_pause_generator_t,
+												completion_latch_notification_t > >(
+										coop, params, counters );
+						} );
+			} );
+
+		const auto takes = counters.m_takes.load();
+		const auto lease_requests = counters.m_lease_requests.load();
+		fmt::print( "seats: {}, leaves: {}, inner waiters: {}, depth: {}\n"
+				"takes: {}, lease requests: {} ({:.2f}%), recalls: {}, "
+				"elapsed: {:.3f}s\n",
+				params.m_seats,
+				shape.m_leaves,
+				shape.m_inner_waiters,
+				shape.m_depth,
+				takes,
+				lease_requests,
+				takes ? 100.0 * lease_requests / takes : 0.0,
+				counters.m_recalls.load(),
+				std::chrono::duration< double >(
+						std::chrono::steady_clock::now() - started_at ).count() );
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Error: " << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
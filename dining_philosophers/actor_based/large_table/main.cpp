@@ -0,0 +1,451 @@
+#include <dining_philosophers/actor_based/common/philosopher.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/common/memory_usage.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <thread>
+
+//
+// Footprint of very large tables.
+//
+// The example creates a table with a huge count of seats and reports
+// the memory used per seat. There are two kinds of philosophers:
+//
+// - default: philosophers with named states, a state listener and
+//   std::mt19937 for pauses;
+// - compact: there is no state listener, states have no names and pauses
+//   are generated by a random engine with 4 bytes of state.
+//
+// And two kinds of forks:
+//
+// - agents: every fork is an agent;
+// - shared: all forks are handled by one agent, every fork is just an mbox
+//   and a flag.
+//
+// All agents work on the default dispatcher of the environment, so there
+// are no per-agent event queues. Completion of philosophers is counted by
+// completion_latch_t, so there is one notification for the whole table.
+//
+// Agents of huge tables are created in child coops, every child coop is
+// a segment of the table. Child coops are built and registered by several
+// threads in parallel: coops with fork agents first, then coops with
+// philosophers, so no philosopher sends take_t to a fork that isn't
+// registered yet. Times of the startup and of the shutdown are
+// reported separately from the time of the simulation.
+//
+
+// A fork that listens to the given mbox. Mboxes of all forks are created
+// before agents, so philosophers and forks can be placed in different
+// coops.
+class fork_t final : public so_5::agent_t
+{
+public :
+	fork_t(
+		context_t ctx,
+		const so_5::mbox_t & mbox,
+		const reply_table_t & replies )
+		:	so_5::agent_t( ctx )
+		,	m_replies{ replies }
+	{
+		this >>= st_free;
+
+		so_subscribe( mbox ).in( st_free )
+			.event( [this]( mhood_t<take_t> cmd )
+				{
+					this >>= st_taken;
+					so_5::send< taken_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
+				} );
+
+		so_subscribe( mbox ).in( st_taken )
+			.event( [this]( mhood_t<take_t> cmd )
+				{
+					so_5::send< busy_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
+				} )
+			.just_switch_to< put_t >( st_free );
+	}
+
+private :
+	const state_t st_free{ this };
+	const state_t st_taken{ this };
+
+	const reply_table_t & m_replies;
+};
+
+// All forks of the table in one agent. Forks behave like fork_t.
+class fork_table_t final : public so_5::agent_t
+{
+public :
+	fork_table_t(
+		context_t ctx,
+		std::size_t count,
+		const reply_table_t & replies )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_replies{ replies }
+		,	m_taken( count, false )
+	{
+		m_fork_mboxes.reserve( count );
+		for( std::size_t i{}; i != count; ++i )
+			m_fork_mboxes.push_back( so_environment().create_mbox() );
+	}
+
+	// Get mbox of fork with specified index.
+	const so_5::mbox_t & fork_mbox( std::size_t index ) const noexcept
+	{
+		return m_fork_mboxes[ index ];
+	}
+
+	void so_define_agent() override
+	{
+		for( std::size_t i{}; i != m_fork_mboxes.size(); ++i )
+		{
+			so_subscribe( fork_mbox( i ) )
+				.event( [i, this]( mhood_t<take_t> cmd ) {
+						const auto reply_mbox =
+								m_replies.reply_mbox( cmd->m_philosopher_index );
+						if( m_taken[ i ] )
+							so_5::send< busy_t >( reply_mbox );
+						else
+						{
+							m_taken[ i ] = true;
+							so_5::send< taken_t >( reply_mbox );
+						}
+					} )
+				.event( [i, this]( mhood_t<put_t> ) {
+						m_taken[ i ] = false;
+					} );
+		}
+	}
+
+private :
+	const reply_table_t & m_replies;
+
+	std::vector< so_5::mbox_t > m_fork_mboxes;
+	std::vector< bool > m_taken;
+};
+
+enum class forks_kind_t
+{
+	agents,
+	shared
+};
+
+forks_kind_t forks_kind_from_string( const std::string & name )
+{
+	if( "agents" == name ) return forks_kind_t::agents;
+	if( "shared" == name ) return forks_kind_t::shared;
+
+	throw std::invalid_argument( "unknown kind of forks: " + name );
+}
+
+bool compact_philosophers_from_string( const std::string & name )
+{
+	if( "default" == name ) return false;
+	if( "compact" == name ) return true;
+
+	throw std::invalid_argument( "unknown kind of philosophers: " + name );
+}
+
+struct table_params_t
+{
+	std::size_t m_seats;
+	bool m_compact_philosophers;
+	forks_kind_t m_forks;
+	int m_meals_count;
+	// Count of seats in a child coop. Zero means that all agents are
+	// created in one coop.
+	std::size_t m_segment;
+	// Count of threads those build child coops.
+	unsigned int m_build_threads;
+};
+
+//
+// shutdown_timer_t
+//
+// Remembers the moment when the shutdown of the environment is started.
+// It doesn't delay the shutdown.
+//
+class shutdown_timer_t final : public so_5::stop_guard_t
+{
+public :
+	explicit shutdown_timer_t( so_5::environment_t & env )
+		:	m_env{ env }
+	{}
+
+	void stop() noexcept override
+	{
+		m_started_at = std::chrono::steady_clock::now();
+		m_env.remove_stop_guard( shared_from_this() );
+	}
+
+	std::chrono::steady_clock::time_point started_at() const noexcept
+	{
+		return m_started_at;
+	}
+
+private :
+	so_5::environment_t & m_env;
+	std::chrono::steady_clock::time_point m_started_at;
+};
+
+template< typename Philosopher >
+void make_philosophers(
+	so_5::coop_t & coop,
+	const table_params_t & params,
+	reply_table_t & replies,
+	const std::vector< so_5::mbox_t > & forks,
+	completion_latch_t & latch,
+	std::size_t first,
+	std::size_t last )
+{
+	const auto count = params.m_seats;
+
+	// Every philosopher takes the fork with the lower index first.
+	for( std::size_t i = first; i != last; ++i )
+	{
+		const auto left = std::min( i, (i + 1u) % count );
+		const auto right = std::max( i, (i + 1u) % count );
+		auto * philosopher = coop.make_agent< Philosopher >(
+				i,
+				forks[ left ],
+				forks[ right ],
+				params.m_meals_count,
+				backoff_policy_t::uniform,
+				philosopher_policies::completion_latch_notification_t{ latch } );
+		// Philosophers of different segments use different items of
+		// the table, so it can be filled from several threads.
+		replies.register_philosopher( i, philosopher->so_direct_mbox() );
+	}
+}
+
+// Fork agents from the range [first, last).
+void make_fork_agents(
+	so_5::coop_t & coop,
+	const reply_table_t & replies,
+	const std::vector< so_5::mbox_t > & forks,
+	std::size_t first,
+	std::size_t last )
+{
+	for( std::size_t i = first; i != last; ++i )
+		coop.make_agent< fork_t >( forks[ i ], replies );
+}
+
+// Philosophers from the range [first, last).
+void make_segment(
+	so_5::coop_t & coop,
+	const table_params_t & params,
+	reply_table_t & replies,
+	const std::vector< so_5::mbox_t > & forks,
+	completion_latch_t & latch,
+	std::size_t first,
+	std::size_t last )
+{
+	using namespace philosopher_policies;
+
+	if( params.m_compact_philosophers )
+		make_philosophers< basic_philosopher_t<
+						no_tracing_t,
+						compact_pause_generator_t,
+						completion_latch_notification_t > >(
+				coop, params, replies, forks, latch, first, last );
+	else
+		make_philosophers< basic_philosopher_t<
+						default_tracing_t,
+						random_pause_generator_t,
+						completion_latch_notification_t > >(
+				coop, params, replies, forks, latch, first, last );
+}
+
+// Builds and registers child coops for all segments of the table by
+// several threads. Returns when all of them are registered.
+template< typename Segment_Maker >
+void register_segments(
+	so_5::environment_t & env,
+	const so_5::coop_handle_t & parent_handle,
+	const table_params_t & params,
+	Segment_Maker && segment_maker )
+{
+	const auto count = params.m_seats;
+	const auto segments = (count + params.m_segment - 1u) / params.m_segment;
+	std::atomic< std::size_t > next_segment{};
+	std::vector< std::exception_ptr > errors( params.m_build_threads );
+
+	const auto builder = [&]( std::size_t thread_index ) {
+		try
+		{
+			for( auto s = next_segment++; s < segments; s = next_segment++ )
+			{
+				const auto first = s * params.m_segment;
+				const auto last = std::min( count, first + params.m_segment );
+
+				auto coop = env.make_coop( parent_handle );
+				segment_maker( *coop, first, last );
+				env.register_coop( std::move(coop) );
+			}
+		}
+		catch( ... )
+		{
+			errors[ thread_index ] = std::current_exception();
+		}
+	};
+
+	std::vector< std::thread > threads;
+	for( std::size_t i{}; i != params.m_build_threads; ++i )
+		threads.emplace_back( builder, i );
+	for( auto & t : threads )
+		t.join();
+
+	for( const auto & e : errors )
+		if( e )
+			std::rethrow_exception( e );
+}
+
+// The parent coop holds shared parts of the table. Segments of the table
+// are built and registered as child coops by several threads.
+void register_table(
+	so_5::environment_t & env,
+	const table_params_t & params )
+{
+	const auto count = params.m_seats;
+
+	auto parent = env.make_coop();
+
+	// Mboxes of philosophers for replies from forks.
+	auto * replies = parent->take_under_control(
+			std::make_unique< reply_table_t >( count ) );
+
+	std::vector< so_5::mbox_t > forks;
+	forks.reserve( count );
+	if( forks_kind_t::agents == params.m_forks )
+	{
+		for( std::size_t i{}; i != count; ++i )
+			forks.push_back( env.create_mbox() );
+	}
+	else
+	{
+		auto * table = parent->make_agent< fork_table_t >( count, *replies );
+		for( std::size_t i{}; i != count; ++i )
+			forks.push_back( table->fork_mbox( i ) );
+	}
+
+	// Completion of every philosopher isn't shown.
+	auto * latch = parent->take_under_control(
+			std::make_unique< completion_latch_t >( env, count ) );
+	parent->make_agent< completion_watcher_t >( *latch );
+
+	if( 0u == params.m_segment )
+	{
+		if( forks_kind_t::agents == params.m_forks )
+			make_fork_agents( *parent, *replies, forks, 0u, count );
+		make_segment( *parent, params, *replies, forks, *latch, 0u, count );
+		env.register_coop( std::move(parent) );
+		return;
+	}
+
+	const auto parent_handle = env.register_coop( std::move(parent) );
+
+	// A philosopher at the end of a segment uses a fork from the next
+	// segment, so all fork agents have to be registered before the first
+	// philosopher starts.
+	if( forks_kind_t::agents == params.m_forks )
+		register_segments( env, parent_handle, params,
+				[&]( so_5::coop_t & coop, std::size_t first, std::size_t last ) {
+					make_fork_agents( coop, *replies, forks, first, last );
+				} );
+
+	register_segments( env, parent_handle, params,
+			[&]( so_5::coop_t & coop, std::size_t first, std::size_t last ) {
+				make_segment( coop, params, *replies, forks, *latch, first, last );
+			} );
+}
+
+int main( int argc, char ** argv )
+{
+	try
+	{
+		const cmd_line_args_t args{ argc, argv };
+
+		// The size of the table is set by `--seats COUNT`, kinds of
+		// philosophers and forks are set by `--philosophers default|compact`
+		// and `--forks agents|shared` options. Agents are created in child
+		// coops of `--segment SEATS` seats (zero means one coop) by
+		// `--build-threads COUNT` threads.
+		const table_params_t params{
+			std::stoul( args.value_or( "--seats", "100000" ) ),
+			compact_philosophers_from_string(
+					args.value_or( "--philosophers", "compact" ) ),
+			forks_kind_from_string( args.value_or( "--forks", "shared" ) ),
+			std::stoi( args.value_or( "--meals", "3" ) ),
+			std::stoul( args.value_or( "--segment", "10000" ) ),
+			static_cast< unsigned int >( std::max( 1ul, std::stoul(
+					args.value_or( "--build-threads", std::to_string(
+							std::thread::hardware_concurrency() ) ) ) ) )
+		};
+		if( params.m_seats < 2u )
+			throw std::invalid_argument( "there should be at least two seats" );
+
+		fmt::print( "seats: {}, philosophers: {}, forks: {}\n",
+				params.m_seats,
+				params.m_compact_philosophers ? "compact" : "default",
+				forks_kind_t::agents == params.m_forks ? "agents" : "shared" );
+
+		const auto started_at = std::chrono::steady_clock::now();
+		std::shared_ptr< shutdown_timer_t > shutdown_timer;
+		std::chrono::steady_clock::time_point simulation_started_at;
+		so_5::launch( [&]( so_5::environment_t & env ) {
+				shutdown_timer = std::make_shared< shutdown_timer_t >( env );
+				env.setup_stop_guard( shutdown_timer );
+
+				const auto memory_before = memory_usage::resident_bytes();
+				const auto startup_started_at = std::chrono::steady_clock::now();
+
+				register_table( env, params );
+
+				simulation_started_at = std::chrono::steady_clock::now();
+				const auto memory_after = memory_usage::resident_bytes();
+				fmt::print( "startup: {:.3f}s\n",
+						std::chrono::duration< double >(
+								simulation_started_at - startup_started_at ).count() );
+				if( memory_before && memory_after )
+				{
+					const auto used = *memory_after > *memory_before ?
+							*memory_after - *memory_before : std::size_t{};
+					fmt::print( "memory: {:.1f} MiB, per seat: {} bytes\n",
+							static_cast< double >( used ) / (1024.0 * 1024.0),
+							used / params.m_seats );
+				}
+				else
+					fmt::print( "memory: unknown on this platform\n" );
+			} );
+
+		const auto finished_at = std::chrono::steady_clock::now();
+		const auto elapsed = std::chrono::duration< double >(
+				shutdown_timer->started_at() - simulation_started_at ).count();
+		fmt::print( "shutdown: {:.3f}s, total: {:.3f}s\n",
+				std::chrono::duration< double >(
+						finished_at - shutdown_timer->started_at() ).count(),
+				std::chrono::duration< double >(
+						finished_at - started_at ).count() );
+
+		const auto meals = static_cast< std::uint64_t >( params.m_seats ) *
+				static_cast< std::uint64_t >( params.m_meals_count );
+		fmt::print( "meals: {}, elapsed: {:.3f}s, meals/s: {:.1f}\n",
+				meals,
+				elapsed,
+				static_cast< double >( meals ) / elapsed );
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Error: " << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,272 @@
+#include <dining_philosophers/actor_based/common/philosopher.hpp>
+#include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+//
+// Several independent tables in one process.
+//
+// Tables can be run in one environment (one coop per table) or in
+// separate environments (one environment per table, every environment is
+// launched on its own thread). The first mode shows how shared parts of
+// an environment (the timer thread, the mbox registry, named mboxes like
+// "trace_maker" and "completion_watcher") scale with the count of tables.
+//
+
+class fork_t final : public so_5::agent_t
+{
+public :
+	fork_t( context_t ctx, const reply_table_t & replies )
+		:	so_5::agent_t( ctx )
+		,	m_replies{ replies }
+	{
+		this >>= st_free;
+
+		st_free.event( [this]( mhood_t<take_t> cmd )
+				{
+					this >>= st_taken;
+					so_5::send< taken_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
+				} );
+
+		st_taken.event( [this]( mhood_t<take_t> cmd )
+				{
+					so_5::send< busy_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
+				} )
+			.just_switch_to< put_t >( st_free );
+	}
+
+private :
+	const state_t st_free{ this };
+	const state_t st_taken{ this };
+
+	const reply_table_t & m_replies;
+};
+
+enum class run_mode_t
+{
+	// All tables in one environment.
+	shared_env,
+	// An environment for every table.
+	env_per_table
+};
+
+run_mode_t run_mode_from_string( const std::string & name )
+{
+	if( "shared" == name ) return run_mode_t::shared_env;
+	if( "separate" == name ) return run_mode_t::env_per_table;
+
+	throw std::invalid_argument( "unknown mode: " + name );
+}
+
+const char * to_string( run_mode_t mode )
+{
+	return run_mode_t::shared_env == mode ? "shared" : "separate";
+}
+
+enum class dispatcher_t
+{
+	// The default dispatcher of the environment.
+	default_disp,
+	// A one_thread dispatcher for every table.
+	one_thread,
+	// A thread_pool dispatcher for every table.
+	thread_pool,
+	// One thread_pool dispatcher for all tables of the environment.
+	shared_pool
+};
+
+dispatcher_t dispatcher_from_string( const std::string & name )
+{
+	if( "default" == name ) return dispatcher_t::default_disp;
+	if( "one_thread" == name ) return dispatcher_t::one_thread;
+	if( "thread_pool" == name ) return dispatcher_t::thread_pool;
+	if( "shared_pool" == name ) return dispatcher_t::shared_pool;
+
+	throw std::invalid_argument( "unknown dispatcher: " + name );
+}
+
+const char * to_string( dispatcher_t dispatcher )
+{
+	switch( dispatcher )
+	{
+	case dispatcher_t::default_disp: return "default";
+	case dispatcher_t::one_thread: return "one_thread";
+	case dispatcher_t::thread_pool: return "thread_pool";
+	case dispatcher_t::shared_pool: return "shared_pool";
+	}
+
+	return "unknown";
+}
+
+struct run_params_t
+{
+	run_mode_t m_mode;
+	dispatcher_t m_dispatcher;
+	// Count of threads for thread_pool dispatchers.
+	std::size_t m_threads;
+	std::size_t m_tables;
+};
+
+// Makes the factory of binders for tables of an environment.
+auto make_binder_factory( so_5::environment_t & env, const run_params_t & params )
+{
+	so_5::disp_binder_shptr_t shared_binder;
+	if( dispatcher_t::default_disp == params.m_dispatcher )
+		shared_binder = so_5::make_default_disp_binder( env );
+	else if( dispatcher_t::shared_pool == params.m_dispatcher )
+		shared_binder = so_5::disp::thread_pool::make_dispatcher(
+				env, params.m_threads ).binder();
+
+	return [&env, &params, shared_binder]() -> so_5::disp_binder_shptr_t {
+		if( shared_binder )
+			return shared_binder;
+
+		if( dispatcher_t::one_thread == params.m_dispatcher )
+			return so_5::disp::one_thread::make_dispatcher( env ).binder();
+
+		return so_5::disp::thread_pool::make_dispatcher(
+				env, params.m_threads ).binder();
+	};
+}
+
+void make_table(
+	so_5::environment_t & env,
+	so_5::disp_binder_shptr_t binder,
+	const names_holder_t & names )
+{
+	env.introduce_coop( std::move(binder), [&]( so_5::coop_t & coop ) {
+		const auto count = names.size();
+
+		// Mboxes of philosophers for replies from forks.
+		auto * replies = coop.take_under_control(
+				std::make_unique< reply_table_t >( count ) );
+
+		std::vector< so_5::agent_t * > forks( count, nullptr );
+		for( std::size_t i{}; i != count; ++i )
+			forks[ i ] = coop.make_agent< fork_t >( *replies );
+
+		// Every philosopher takes the fork with the lower index first.
+		// It reduces the count of 'busy' replies.
+		for( std::size_t i{}; i != count; ++i )
+		{
+			const auto left = std::min( i, (i + 1u) % count );
+			const auto right = std::max( i, (i + 1u) % count );
+			auto * philosopher = coop.make_agent< philosopher_t >(
+					i,
+					forks[ left ]->so_direct_mbox(),
+					forks[ right ]->so_direct_mbox(),
+					default_meals_count );
+			replies->register_philosopher( i, philosopher->so_direct_mbox() );
+		}
+	});
+}
+
+void run_tables(
+	so_5::environment_t & env,
+	const names_holder_t & names,
+	const run_params_t & params,
+	std::size_t tables_count )
+{
+	env.introduce_coop( [&]( so_5::coop_t & coop ) {
+		coop.make_agent_with_binder< completion_watcher_t >(
+				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				names,
+				tables_count );
+	} );
+
+	const auto binder_factory = make_binder_factory( env, params );
+	for( std::size_t i{}; i != tables_count; ++i )
+		make_table( env, binder_factory(), names );
+}
+
+void run_and_report( const names_holder_t & names, const run_params_t & params )
+{
+	const auto started_at = std::chrono::steady_clock::now();
+
+	if( run_mode_t::shared_env == params.m_mode )
+		so_5::launch( [&]( so_5::environment_t & env ) {
+				run_tables( env, names, params, params.m_tables );
+			} );
+	else
+	{
+		std::vector< std::thread > threads;
+		threads.reserve( params.m_tables );
+		for( std::size_t i{}; i != params.m_tables; ++i )
+			threads.emplace_back( [&] {
+					so_5::launch( [&]( so_5::environment_t & env ) {
+							run_tables( env, names, params, 1u );
+						} );
+				} );
+
+		for( auto & t : threads )
+			t.join();
+	}
+
+	const auto elapsed = std::chrono::duration< double >(
+			std::chrono::steady_clock::now() - started_at ).count();
+	const auto meals = params.m_tables * names.size() * default_meals_count;
+
+	fmt::print( "mode: {:<8} dispatcher: {:<11} tables: {:>3}, cores: {}, "
+			"meals: {}, elapsed: {:.3f}s, meals/s: {:.1f}\n",
+			to_string( params.m_mode ),
+			to_string( params.m_dispatcher ),
+			params.m_tables,
+			std::thread::hardware_concurrency(),
+			meals,
+			elapsed,
+			meals / elapsed );
+}
+
+int main( int argc, char ** argv )
+{
+	try
+	{
+		const cmd_line_args_t args{ argc, argv };
+		const auto cores = std::max( 1u, std::thread::hardware_concurrency() );
+
+		// Mode can be set by `--mode shared|separate` option.
+		// Dispatcher for tables can be set by
+		// `--dispatcher default|one_thread|thread_pool|shared_pool` option
+		// and the size of thread pools by `--threads COUNT`.
+		run_params_t params{
+			run_mode_from_string( args.value_or( "--mode", "shared" ) ),
+			dispatcher_from_string( args.value_or( "--dispatcher", "one_thread" ) ),
+			std::stoul( args.value_or( "--threads", std::to_string( cores ) ) ),
+			std::stoul( args.value_or( "--tables", "4" ) )
+		};
+
+		names_holder_t names{
+			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
+			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"
+		};
+
+		if( args.has_flag( "--sweep" ) )
+		{
+			// Count of tables is doubled till `--max-tables COUNT`.
+			const auto max_tables = std::stoul( args.value_or(
+					"--max-tables", std::to_string( 2u * cores ) ) );
+			for( std::size_t t = 1u; t <= max_tables; t *= 2u )
+			{
+				params.m_tables = t;
+				run_and_report( names, params );
+			}
+		}
+		else
+			run_and_report( names, params );
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Error: " << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
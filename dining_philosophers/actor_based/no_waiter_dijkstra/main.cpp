@@ -1,10 +1,17 @@
 #include <dining_philosophers/common/fork_messages.hpp>
 #include <dining_philosophers/common/random_generator.hpp>
 #include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
 #include <dining_philosophers/actor_based/trace_maker/all.hpp>
+#include <dining_philosophers/actor_based/common/philosopher.hpp>
 #include <dining_philosophers/actor_based/common/completion_watcher.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/actor_based/common/launch.hpp>
+#include <dining_philosophers/actor_based/common/stats_collector.hpp>
+#include <dining_philosophers/actor_based/common/trace_observer_agent.hpp>
 
-#include <queue>
+#include <algorithm>
+#include <deque>
 
 // An actor for representing a fork.
 // Fork can be in two states: 'free' and 'taken'.
@@ -12,7 +19,10 @@
 class fork_t final : public so_5::agent_t
 {
 public :
-	fork_t( context_t ctx ) : so_5::agent_t{ std::move(ctx) } {}
+	fork_t( context_t ctx, const reply_table_t & replies )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_replies{ replies }
+	{}
 
 	void so_define_agent() override
 	{
@@ -23,14 +33,27 @@ public :
 		st_free
 			.event( [this]( mhood_t<take_t> cmd ) {
 					this >>= st_taken;
-					so_5::send< taken_t >( cmd->m_who );
+					so_5::send< taken_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
 				} );
 
-		// In 'taken' state we should handle two messages.
+		// In 'taken' state we should handle three messages.
 		st_taken
 			.event( [this]( mhood_t<take_t> cmd ) {
 					// The requester should wait for some time.
-					m_queue.push( cmd->m_who );
+					m_queue.push_back( cmd->m_philosopher_index );
+				} )
+			.event( [this]( mhood_t<cancel_take_t> cmd ) {
+					const auto it = std::find( m_queue.begin(), m_queue.end(),
+							cmd->m_philosopher_index );
+					// If the requester isn't in the queue then the fork is
+					// already given to it. The requester will return the fork.
+					if( it != m_queue.end() )
+					{
+						m_queue.erase( it );
+						so_5::send< cancelled_t >(
+								m_replies.reply_mbox( cmd->m_philosopher_index ) );
+					}
 				} )
 			.event( [this]( mhood_t<put_t> ) {
 					if( m_queue.empty() )
@@ -40,8 +63,8 @@ public :
 					{
 						// The first philosopher from wait queue should be notified.
 						const auto who = m_queue.front();
-						m_queue.pop();
-						so_5::send< taken_t >( who );
+						m_queue.pop_front();
+						so_5::send< taken_t >( m_replies.reply_mbox( who ) );
 					}
 				} );
 	}
@@ -51,13 +74,20 @@ private :
 	const state_t st_free{ this, "free" };
 	const state_t st_taken{ this, "taken" };
 
-	// Wait queue for philosophers.
-	std::queue< so_5::mbox_t > m_queue;
+	// Mboxes of philosophers for replies.
+	const reply_table_t & m_replies;
+
+	// Wait queue for philosophers. Every philosopher is identified by index.
+	std::deque< std::size_t > m_queue;
 };
 
 // An actor for representing a philosopher.
 // If this philosopher takes a fork it doesn't return it until he/she
 // takes the second fork and eats his/her meal.
+//
+// If the deadline for acquisition of forks is set then the philosopher
+// withdraws his/her requests when the deadline is missed, returns the taken
+// fork (if any) and tries again after hungry thinking.
 class greedy_philosopher_t final
 	: public so_5::agent_t
 	, private random_pause_generator_t
@@ -66,22 +96,40 @@ class greedy_philosopher_t final
 	struct stop_thinking_t : public so_5::signal_t {};
 	struct stop_eating_t : public so_5::signal_t {};
 
+	// Message to be used for limiting the time of forks acquisition.
+	// A message from an earlier attempt can arrive too late, so every
+	// message holds the number of attempt.
+	struct deadline_missed_t final : public so_5::message_t
+	{
+		const unsigned int m_attempt;
+
+		explicit deadline_missed_t( unsigned int attempt )
+			:	m_attempt{ attempt }
+		{}
+	};
+
+	// Tracing is turned off by DINING_PHILOSOPHERS_NO_TRACING as for
+	// philosopher_t.
+	using tracing_t = philosopher_policies::default_tracing_t;
+
 public :
 	greedy_philosopher_t(
 		context_t ctx,
 		std::size_t index,
 		so_5::mbox_t left_fork,
 		so_5::mbox_t right_fork,
-		int meals_count )
+		int meals_count,
+		// Zero value means that there is no deadline.
+		std::chrono::steady_clock::duration deadline )
 		:	so_5::agent_t{ std::move(ctx) }
 		,	m_index{ index }
 		,	m_left_fork{ std::move( left_fork ) }
 		,	m_right_fork{ std::move( right_fork ) }
 		,	m_meals_count{ meals_count }
+		,	m_deadline{ deadline }
 	{
 		// This is necessary for tracing of state changes.
-		so_add_destroyable_listener(
-				state_watcher_t::make( so_environment(), index ) );
+		install_tracing< tracing_t >( index );
 	}
 
 	void so_define_agent() override
@@ -91,23 +139,64 @@ public :
 			.event( [this]( mhood_t<stop_thinking_t> ) {
 					// Try to get the left fork.
 					this >>= st_wait_left;
-					so_5::send< take_t >( m_left_fork, so_direct_mbox(), m_index );
+					so_5::send< take_t >( m_left_fork, m_index );
+
+					// Acquisition of forks should be limited.
+					++m_attempt;
+					if( std::chrono::steady_clock::duration::zero() != m_deadline )
+						so_5::send_delayed< deadline_missed_t >(
+								*this, m_deadline, m_attempt );
 				} );
 
-		// When we wait for the left fork we react only to 'taken' reply.
+		// When we wait for the left fork we react to 'taken' reply
+		// and to the missed deadline.
 		st_wait_left
 			.event( [this]( mhood_t<taken_t> ) {
 					// Now we have the left fork.
 					// Try to get the right fork.
 					this >>= st_wait_right;
-					so_5::send< take_t >( m_right_fork, so_direct_mbox(), m_index );
+					so_5::send< take_t >( m_right_fork, m_index );
+				} )
+			.event( [this]( mhood_t<deadline_missed_t> cmd ) {
+					if( is_actual( *cmd ) )
+						withdraw( st_cancel_left, m_left_fork );
 				} );
 
-		// When we wait for the right fork we react only to 'taken' reply.
+		// When we wait for the right fork we react to 'taken' reply
+		// and to the missed deadline.
 		st_wait_right
 			.event( [this]( mhood_t<taken_t> ) {
 					// We have both forks. Can eat our meal.
 					this >>= st_eating;
+				} )
+			.event( [this]( mhood_t<deadline_missed_t> cmd ) {
+					if( is_actual( *cmd ) )
+						withdraw( st_cancel_right, m_right_fork );
+				} );
+
+		// The request for the left fork is withdrawn.
+		// Now we wait for a confirmation or for the fork given before
+		// the withdrawal.
+		st_cancel_left
+			.event( [this]( mhood_t<cancelled_t> ) {
+					think( st_hungry_thinking );
+				} )
+			.event( [this]( mhood_t<taken_t> ) {
+					so_5::send< put_t >( m_left_fork );
+					think( st_hungry_thinking );
+				} );
+
+		// The request for the right fork is withdrawn.
+		// The left fork should be returned in any case.
+		st_cancel_right
+			.event( [this]( mhood_t<cancelled_t> ) {
+					so_5::send< put_t >( m_left_fork );
+					think( st_hungry_thinking );
+				} )
+			.event( [this]( mhood_t<taken_t> ) {
+					so_5::send< put_t >( m_right_fork );
+					so_5::send< put_t >( m_left_fork );
+					think( st_hungry_thinking );
 				} );
 
 		// When we in 'eating' state we react only to 'stop_eating' signal.
@@ -126,30 +215,53 @@ public :
 				if( m_meals_count == m_meals_eaten )
 					this >>= st_done; // No more meals to eat, we are done.
 				else
-					think();
+					think( st_normal_thinking );
 			} );
 
 		st_done
 			.on_enter( [this] {
 				// Notify about completion.
-				completion_watcher_t::done( so_environment(), m_index );
+				completion_watcher_t::done(
+						so_environment(), m_index, 0u, m_timeouts );
 			} );
 	}
 
 	void so_evt_start() override
 	{
 		// Agent should start in 'thinking' state.
-		think();
+		think( st_normal_thinking );
 	}
 
 private :
+	static std::string state_name( const char * name )
+	{
+		return philosopher_policies::state_name< tracing_t >( name );
+	}
+
+	// It's a template for discarding of the listener when tracing
+	// is turned off.
+	template< typename Tracing >
+	void install_tracing( std::size_t index )
+	{
+		if constexpr( Tracing::enabled )
+			so_add_destroyable_listener(
+					Tracing::make_listener( so_environment(), index ) );
+	}
+
 	// States of the agent.
-	state_t st_thinking{ this, "thinking.normal" };
-	state_t st_wait_left{ this, "wait_left" };
-	state_t st_wait_right{ this, "wait_right" };
-	state_t st_eating{ this, "eating" };
+	state_t st_thinking{ this, state_name( "thinking" ) };
+	state_t st_normal_thinking{
+			initial_substate_of{ st_thinking }, state_name( "normal" ) };
+	state_t st_hungry_thinking{
+			substate_of{ st_thinking }, state_name( "hungry" ) };
 
-	state_t st_done{ this, "done" };
+	state_t st_wait_left{ this, state_name( "wait_left" ) };
+	state_t st_wait_right{ this, state_name( "wait_right" ) };
+	state_t st_cancel_left{ this, state_name( "cancel_left" ) };
+	state_t st_cancel_right{ this, state_name( "cancel_right" ) };
+	state_t st_eating{ this, state_name( "eating" ) };
+
+	state_t st_done{ this, state_name( "done" ) };
 
 	// Philosopher's index.
 	const std::size_t m_index;
@@ -161,63 +273,123 @@ private :
 	const int m_meals_count;
 	int m_meals_eaten{};
 
+	// Time limit for acquisition of both forks.
+	const std::chrono::steady_clock::duration m_deadline;
+	// Number of the current attempt to take forks.
+	unsigned int m_attempt{};
+	// Count of missed deadlines.
+	unsigned int m_timeouts{};
+
 	// Switch agent to 'thinking' state and limit thinking time by delayed message.
-	void think()
+	void think( const state_t & target_st )
 	{
-		this >>= st_thinking;
+		this >>= target_st;
 		so_5::send_delayed< stop_thinking_t >(
 				*this,
-				think_pause( thinking_type_t::normal ) );
+				think_pause( target_st == st_normal_thinking
+						? thinking_type_t::normal : thinking_type_t::hungry ) );
+	}
+
+	// Is the deadline related to the current attempt?
+	bool is_actual( const deadline_missed_t & msg ) const noexcept
+	{
+		return m_attempt == msg.m_attempt;
+	}
+
+	// Withdraw the request for the fork we are waiting for.
+	void withdraw( const state_t & target_st, const so_5::mbox_t & fork )
+	{
+		++m_timeouts;
+		this >>= target_st;
+		so_5::send< cancel_take_t >( fork, m_index );
 	}
 };
 
-void run_simulation( so_5::environment_t & env, const names_holder_t & names )
+void run_simulation(
+	so_5::environment_t & env,
+	const names_holder_t & names,
+	std::chrono::steady_clock::duration deadline,
+	bool single_threaded,
+	const stats_params_t & stats_params,
+	const trace::observers_params_t & observers_params )
 {
 	env.introduce_coop( [&]( so_5::coop_t & coop ) {
 		coop.make_agent_with_binder< trace_maker_t >(
-				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				auxiliary_binder( env, single_threaded ),
 				names,
 				random_pause_generator_t::trace_step() );
 
+		make_trace_observers( coop,
+				auxiliary_binder( env, single_threaded ),
+				names,
+				observers_params );
+
 		coop.make_agent_with_binder< completion_watcher_t >(
-				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				auxiliary_binder( env, single_threaded ),
 				names );
 
+		make_stats_collector( coop,
+				auxiliary_binder( env, single_threaded ),
+				stats_params );
+
 		const auto count = names.size();
 
+		// Mboxes of philosophers for replies from forks.
+		auto * replies = coop.take_under_control(
+				std::make_unique< reply_table_t >( count ) );
+
 		// Create forks.
 		std::vector< so_5::agent_t * > forks( count, nullptr );
 		for( std::size_t i{}; i != count; ++i )
-			forks[ i ] = coop.make_agent< fork_t >();
+			forks[ i ] = coop.make_agent< fork_t >( *replies );
 
 		// Create philosophers.
+		const auto philosopher_maker =
+				[&]( auto index, auto left_fork_idx, auto right_fork_idx ) {
+					auto * philosopher = coop.make_agent< greedy_philosopher_t >(
+							index,
+							forks[ left_fork_idx ]->so_direct_mbox(),
+							forks[ right_fork_idx ]->so_direct_mbox(),
+							default_meals_count,
+							deadline );
+					replies->register_philosopher(
+							index, philosopher->so_direct_mbox() );
+				};
 		for( std::size_t i{}; i != count - 1u; ++i )
-			coop.make_agent< greedy_philosopher_t >(
-					i,
-					forks[ i ]->so_direct_mbox(),
-					forks[ i + 1 ]->so_direct_mbox(),
-					default_meals_count );
+			philosopher_maker( i, i, i + 1u );
 		// The last philosopher should take forks in opposite direction.
-		coop.make_agent< greedy_philosopher_t >(
-				count - 1u,
-				forks[ count - 1u ]->so_direct_mbox(),
-				forks[ 0 ]->so_direct_mbox(),
-				default_meals_count );
+		philosopher_maker( count - 1u, count - 1u, std::size_t{ 0u } );
 	});
 }
 
-int main()
+int main( int argc, char ** argv )
 {
 	try
 	{
+		const cmd_line_args_t args{ argc, argv };
+		// Time limit for acquisition of forks can be set by
+		// `--deadline MILLISECONDS` option. There is no limit by default.
+		const std::chrono::milliseconds deadline{
+				std::stoul( args.value_or( "--deadline", "0" ) ) };
+		// All agents work on one thread if `--single-threaded` is specified.
+		const bool single_threaded = args.has_flag( "--single-threaded" );
+		const auto stats_params = stats_params_t::from_cmd_line( args );
+		const auto observers_params =
+				trace::observers_params_t::from_cmd_line( args );
+
 		names_holder_t names{
 			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
 			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"	
 		};
 
-		so_5::launch( [&]( so_5::environment_t & env ) {
-				run_simulation( env, names );
-			} );
+		launch_simulation( single_threaded,
+				[&]( so_5::environment_t & env ) {
+					run_simulation( env, names, deadline,
+							single_threaded, stats_params, observers_params );
+				},
+				[&]( so_5::environment_params_t & params ) {
+					stats_params.tune( params );
+				} );
 	}
 	catch( const std::exception & ex )
 	{
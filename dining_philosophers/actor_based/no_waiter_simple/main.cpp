@@ -1,70 +1,141 @@
 #include <dining_philosophers/actor_based/common/philosopher.hpp>
 #include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/actor_based/common/launch.hpp>
+#include <dining_philosophers/actor_based/common/stats_collector.hpp>
+#include <dining_philosophers/actor_based/common/soak_mode.hpp>
 
 class fork_t final : public so_5::agent_t
 {
 public :
-	fork_t( context_t ctx ) : so_5::agent_t( ctx )
+	fork_t( context_t ctx, const reply_table_t & replies )
+		:	so_5::agent_t( ctx )
+		,	m_replies{ replies }
    {
 		this >>= st_free;
 
 		st_free.event( [this]( mhood_t<take_t> cmd )
 				{
+					const auto measure = m_timing.measure( take_when_free, cmd );
 					this >>= st_taken;
-					so_5::send< taken_t >( cmd->m_who );
+					so_5::send< taken_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
 				} );
 
-		st_taken.event( []( mhood_t<take_t> cmd )
+		st_taken.event( [this]( mhood_t<take_t> cmd )
 				{
-					so_5::send< busy_t >( cmd->m_who );
+					const auto measure = m_timing.measure( take_when_taken, cmd );
+					so_5::send< busy_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
 				} )
-			.just_switch_to< put_t >( st_free );
+			.event( [this]( mhood_t<put_t> cmd )
+				{
+					const auto measure = m_timing.measure( put, cmd );
+					this >>= st_free;
+				} );
 	}
 
 private :
+	// Indexes of handlers in m_timing.
+	enum timed_handler_t : std::size_t
+	{
+		take_when_free,
+		take_when_taken,
+		put
+	};
+
 	const state_t st_free{ this };
 	const state_t st_taken{ this };
+
+	const reply_table_t & m_replies;
+
+	handler_timing::table_t m_timing{
+			"fork_t", { "take (free)", "take (taken)", "put" } };
 };
 
-void run_simulation( so_5::environment_t & env, const names_holder_t & names )
+void run_simulation(
+	so_5::environment_t & env,
+	const names_holder_t & names,
+	backoff_policy_t backoff_policy,
+	bool single_threaded,
+	const stats_params_t & stats_params,
+	const soak_params_t & soak_params,
+	const trace::observers_params_t & observers_params )
 {
 	env.introduce_coop( [&]( so_5::coop_t & coop ) {
-		coop.make_agent_with_binder< trace_maker_t >(
-				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+		make_trace_maker( coop,
+				auxiliary_binder( env, single_threaded ),
 				names,
-				random_pause_generator_t::trace_step() );
+				soak_params );
+
+		make_trace_observers( coop,
+				auxiliary_binder( env, single_threaded ),
+				names,
+				observers_params );
 
 		coop.make_agent_with_binder< completion_watcher_t >(
-				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				auxiliary_binder( env, single_threaded ),
 				names );
 
+		make_stats_collector( coop,
+				auxiliary_binder( env, single_threaded ),
+				stats_params );
+
 		const auto count = names.size();
 
+		// Mboxes of philosophers for replies from forks.
+		auto * replies = coop.take_under_control(
+				std::make_unique< reply_table_t >( count ) );
+
 		std::vector< so_5::agent_t * > forks( count, nullptr );
 		for( std::size_t i{}; i != count; ++i )
-			forks[ i ] = coop.make_agent< fork_t >();
+			forks[ i ] = coop.make_agent< fork_t >( *replies );
 
 		for( std::size_t i{}; i != count; ++i )
-			coop.make_agent< philosopher_t >(
+		{
+			auto * philosopher = coop.make_agent< philosopher_t >(
 					i,
 					forks[ i ]->so_direct_mbox(),
 					forks[ (i + 1) % count ]->so_direct_mbox(),
-					default_meals_count );
+					soak_params.meals_count(),
+					backoff_policy );
+			replies->register_philosopher( i, philosopher->so_direct_mbox() );
+		}
 	});
 }
 
-int main()
+int main( int argc, char ** argv )
 {
 	try
 	{
+		const cmd_line_args_t args{ argc, argv };
+		// Policy for hungry thinking can be changed by `--backoff NAME` option.
+		const auto backoff_policy = backoff_policy_from_string(
+				args.value_or( "--backoff", "exponential" ) );
+		// All agents work on one thread if `--single-threaded` is specified.
+		const bool single_threaded = args.has_flag( "--single-threaded" );
+		const auto stats_params = stats_params_t::from_cmd_line( args );
+		const auto soak_params = soak_params_t::from_cmd_line( args );
+		const auto observers_params =
+				trace::observers_params_t::from_cmd_line( args );
+
 		names_holder_t names{
 			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
 			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"	
 		};
 
-		so_5::launch( [&]( so_5::environment_t & env ) {
-				run_simulation( env, names );
-			} );
+		launch_simulation( single_threaded,
+				[&]( so_5::environment_t & env ) {
+					run_simulation( env, names, backoff_policy,
+							single_threaded, stats_params, soak_params,
+							observers_params );
+				},
+				[&]( so_5::environment_params_t & params ) {
+					stats_params.tune( params );
+				} );
+
+		handler_timing::report();
 	}
 	catch( const std::exception & ex )
 	{
@@ -1,45 +1,226 @@
 #include <dining_philosophers/actor_based/common/philosopher.hpp>
 #include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/common/cpu_time.hpp>
+#include <dining_philosophers/actor_based/common/stats_collector.hpp>
+#include <dining_philosophers/actor_based/common/trace_observer_agent.hpp>
+
+#include <algorithm>
 
 class fork_t final : public so_5::agent_t
 {
 public :
-	fork_t( context_t ctx ) : so_5::agent_t( ctx )
+	fork_t( context_t ctx, const reply_table_t & replies )
+		:	so_5::agent_t( ctx )
+		,	m_replies{ replies }
    {
 		this >>= st_free;
 
 		st_free.event( [this]( mhood_t<take_t> cmd )
 				{
+					const auto measure = m_timing.measure( take_when_free, cmd );
 					this >>= st_taken;
-					so_5::send< taken_t >( cmd->m_who );
+					so_5::send< taken_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
 				} );
 
-		st_taken.event( []( mhood_t<take_t> cmd )
+		st_taken.event( [this]( mhood_t<take_t> cmd )
 				{
-					so_5::send< busy_t >( cmd->m_who );
+					const auto measure = m_timing.measure( take_when_taken, cmd );
+					so_5::send< busy_t >(
+							m_replies.reply_mbox( cmd->m_philosopher_index ) );
 				} )
-			.just_switch_to< put_t >( st_free );
+			.event( [this]( mhood_t<put_t> cmd )
+				{
+					const auto measure = m_timing.measure( put, cmd );
+					this >>= st_free;
+				} );
 	}
 
 private :
+	// Indexes of handlers in m_timing.
+	enum timed_handler_t : std::size_t
+	{
+		take_when_free,
+		take_when_taken,
+		put
+	};
+
 	const state_t st_free{ this };
 	const state_t st_taken{ this };
+
+	const reply_table_t & m_replies;
+
+	handler_timing::table_t m_timing{
+			"fork_t", { "take (free)", "take (taken)", "put" } };
+};
+
+// Lock factory for queues of a thread_pool dispatcher.
+struct lock_spec_t
+{
+	std::string m_name;
+	so_5::disp::thread_pool::queue_traits::lock_factory_t m_factory;
+};
+
+// Possible values:
+//
+// "simple" for locks based on mutex and condition variable;
+// "combined" for combined locks with the default spinning time;
+// "combined:MICROSECONDS" for combined locks with the specified
+// spinning time.
+//
+lock_spec_t lock_spec_from_string( const std::string & name )
+{
+	namespace queue_traits = so_5::disp::thread_pool::queue_traits;
+
+	if( "simple" == name )
+		return { name, queue_traits::simple_lock_factory() };
+	if( "combined" == name )
+		return { name, queue_traits::combined_lock_factory() };
+
+	const std::string combined_prefix{ "combined:" };
+	if( 0 == name.compare( 0u, combined_prefix.size(), combined_prefix ) )
+		return { name, queue_traits::combined_lock_factory(
+				std::chrono::microseconds{
+						std::stoul( name.substr( combined_prefix.size() ) ) } ) };
+
+	throw std::invalid_argument( "unknown lock factory: " + name );
+}
+
+struct run_params_t
+{
+	lock_spec_t m_fork_lock;
+	lock_spec_t m_philosopher_lock;
+	// Sweep mode: there is no tracing at all and the delivery latency
+	// is measured by probes.
+	bool m_sweep;
+	stats_params_t m_stats;
+	trace::observers_params_t m_observers;
+};
+
+// Latency of delivery of messages to the fork dispatcher.
+struct delivery_latency_t
+{
+	std::size_t m_count{};
+	std::chrono::steady_clock::duration m_total{};
+	std::chrono::steady_clock::duration m_max{};
+};
+
+// Timestamped message for measurement of delivery latency.
+struct probe_t
+{
+	std::chrono::steady_clock::time_point m_sent_at;
+};
+
+// Sends probes from the philosopher dispatcher.
+class probe_sender_t final : public so_5::agent_t
+{
+	struct tick_t final : public so_5::signal_t {};
+
+public :
+	probe_sender_t( context_t ctx, so_5::mbox_t receiver )
+		:	so_5::agent_t{ std::move(ctx) }
+		,	m_receiver{ std::move(receiver) }
+	{
+		so_subscribe_self().event( [this]( mhood_t<tick_t> ) {
+				so_5::send< probe_t >(
+						m_receiver, std::chrono::steady_clock::now() );
+			} );
+	}
+
+	void so_evt_start() override
+	{
+		m_timer = so_5::send_periodic< tick_t >( *this,
+				std::chrono::milliseconds{ 5 },
+				std::chrono::milliseconds{ 5 } );
+	}
+
+private :
+	const so_5::mbox_t m_receiver;
+	so_5::timer_id_t m_timer;
+};
+
+// Receives probes on the fork dispatcher.
+class probe_receiver_t final : public so_5::agent_t
+{
+public :
+	probe_receiver_t( context_t ctx, delivery_latency_t & latency )
+		:	so_5::agent_t{ std::move(ctx) }
+	{
+		so_subscribe_self().event( [&latency]( mhood_t<probe_t> cmd ) {
+				const auto l = std::chrono::steady_clock::now() - cmd->m_sent_at;
+				++latency.m_count;
+				latency.m_total += l;
+				latency.m_max = std::max( latency.m_max, l );
+			} );
+	}
 };
 
-void run_simulation( so_5::environment_t & env, const names_holder_t & names )
+so_5::disp::thread_pool::disp_params_t make_disp_params(
+	std::size_t thread_count,
+	const lock_spec_t & lock )
+{
+	return so_5::disp::thread_pool::disp_params_t{}
+			.thread_count( thread_count )
+			.tune_queue_params(
+				[&lock]( so_5::disp::thread_pool::queue_traits::queue_params_t & p ) {
+					p.lock_factory( lock.m_factory );
+				} );
+}
+
+template< typename Philosopher >
+void make_philosophers(
+	so_5::coop_t & coop,
+	so_5::disp_binder_shptr_t binder,
+	reply_table_t & replies,
+	const std::vector< so_5::agent_t * > & forks )
+{
+	const auto count = forks.size();
+	for( std::size_t i{}; i != count; ++i )
+	{
+		auto * philosopher = coop.make_agent_with_binder< Philosopher >(
+				binder,
+				i,
+				forks[ i ]->so_direct_mbox(),
+				forks[ (i + 1) % count ]->so_direct_mbox(),
+				default_meals_count );
+		replies.register_philosopher( i, philosopher->so_direct_mbox() );
+	}
+}
+
+void run_simulation(
+	so_5::environment_t & env,
+	const names_holder_t & names,
+	const run_params_t & params,
+	delivery_latency_t & latency )
 {
 	env.introduce_coop( [&]( so_5::coop_t & coop ) {
-		coop.make_agent_with_binder< trace_maker_t >(
+		if( !params.m_sweep )
+			coop.make_agent_with_binder< trace_maker_t >(
+					so_5::disp::one_thread::make_dispatcher( env ).binder(),
+					names,
+					random_pause_generator_t::trace_step() );
+
+		make_trace_observers( coop,
 				so_5::disp::one_thread::make_dispatcher( env ).binder(),
 				names,
-				random_pause_generator_t::trace_step() );
+				params.m_observers );
 
 		coop.make_agent_with_binder< completion_watcher_t >(
 				so_5::disp::one_thread::make_dispatcher( env ).binder(),
 				names );
 
+		make_stats_collector( coop,
+				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				params.m_stats );
+
 		const auto count = names.size();
 
+		// Mboxes of philosophers for replies from forks.
+		auto * replies = coop.take_under_control(
+				std::make_unique< reply_table_t >( count ) );
+
 		// Params for tuning thread_pool behavior.
 		so_5::disp::thread_pool::bind_params_t bind_params;
 		bind_params.fifo( so_5::disp::thread_pool::fifo_t::individual );
@@ -48,40 +229,117 @@ void run_simulation( so_5::environment_t & env, const names_holder_t & names )
 		// Create a thread_pool dispatcher for fork agents.
 		auto fork_disp = so_5::disp::thread_pool::make_dispatcher(
 					env,
-					3u // Size of the pool
+					"forks",
+					make_disp_params( 3u /* Size of the pool */, params.m_fork_lock )
 				);
 		for( std::size_t i{}; i != count; ++i )
 			// Every fork actor will be bound to fork_disp dispatcher.
 			forks[ i ] = coop.make_agent_with_binder< fork_t >(
-					fork_disp.binder( bind_params ) );
+					fork_disp.binder( bind_params ),
+					*replies );
 
 		// Create a thread_pool dispatcher for philosopher agents.
 		auto philosopher_disp = so_5::disp::thread_pool::make_dispatcher(
 					env,
-					6u // Size of the pool
+					"philosophers",
+					make_disp_params( 6u /* Size of the pool */,
+							params.m_philosopher_lock )
 				);
-		for( std::size_t i{}; i != count; ++i )
-			coop.make_agent_with_binder< philosopher_t >(
+		if( !params.m_sweep )
+			make_philosophers< philosopher_t >(
+					coop, philosopher_disp.binder( bind_params ), *replies, forks );
+		else
+		{
+			// There is no trace_maker_t in sweep mode, so philosophers don't
+			// send their states.
+			make_philosophers< basic_philosopher_t<
+							philosopher_policies::no_tracing_t > >(
+					coop, philosopher_disp.binder( bind_params ), *replies, forks );
+
+			// Probes go the same way as requests from philosophers to forks.
+			auto * receiver = coop.make_agent_with_binder< probe_receiver_t >(
+					fork_disp.binder( bind_params ),
+					latency );
+			coop.make_agent_with_binder< probe_sender_t >(
 					philosopher_disp.binder( bind_params ),
-					i,
-					forks[ i ]->so_direct_mbox(),
-					forks[ (i + 1) % count ]->so_direct_mbox(),
-					default_meals_count );
+					receiver->so_direct_mbox() );
+		}
 	});
 }
 
-int main()
+void run_and_report( const names_holder_t & names, const run_params_t & params )
+{
+	delivery_latency_t latency;
+
+	const auto started_at = std::chrono::steady_clock::now();
+	// CPU time of all threads of the process.
+	const auto cpu_started_at = cpu_time::process_time();
+
+	so_5::launch(
+			[&]( so_5::environment_t & env ) {
+				run_simulation( env, names, params, latency );
+			},
+			[&]( so_5::environment_params_t & env_params ) {
+				params.m_stats.tune( env_params );
+			} );
+
+	const auto cpu_finished_at = cpu_time::process_time();
+	using us_t = std::chrono::duration< double, std::micro >;
+
+	fmt::print( "fork lock: {:<14} philosopher lock: {:<14} wall: {:.3f}s, ",
+			params.m_fork_lock.m_name,
+			params.m_philosopher_lock.m_name,
+			std::chrono::duration< double >(
+					std::chrono::steady_clock::now() - started_at ).count() );
+	if( cpu_started_at && cpu_finished_at )
+		fmt::print( "cpu: {:.3f}s", (*cpu_finished_at - *cpu_started_at).count() );
+	else
+		fmt::print( "cpu: unknown" );
+	if( params.m_sweep )
+		fmt::print( ", delivery latency avg: {:.1f}us, max: {:.1f}us",
+				latency.m_count ?
+						us_t( latency.m_total ).count() / latency.m_count : 0.0,
+				us_t( latency.m_max ).count() );
+	fmt::print( "\n" );
+
+	// Every run has its own histograms, otherwise lock factories of
+	// sweep mode can't be compared.
+	handler_timing::report();
+	handler_timing::reset();
+}
+
+int main( int argc, char ** argv )
 {
 	try
 	{
+		const cmd_line_args_t args{ argc, argv };
+
 		names_holder_t names{
 			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
 			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"	
 		};
 
-		so_5::launch( [&]( so_5::environment_t & env ) {
-				run_simulation( env, names );
-			} );
+		if( args.has_flag( "--sweep" ) )
+		{
+			// Every lock factory is used for both dispatchers.
+			for( const auto * name : { "simple", "combined:0", "combined:10",
+					"combined:100", "combined:1000", "combined" } )
+			{
+				const auto lock = lock_spec_from_string( name );
+				run_and_report( names, run_params_t{ lock, lock, true, {}, {} } );
+			}
+		}
+		else
+			// Lock factories can be set by `--fork-lock NAME` and
+			// `--philosopher-lock NAME` options.
+			run_and_report( names, run_params_t{
+					lock_spec_from_string(
+							args.value_or( "--fork-lock", "combined" ) ),
+					lock_spec_from_string(
+							args.value_or( "--philosopher-lock", "combined" ) ),
+					false,
+					stats_params_t::from_cmd_line( args ),
+					trace::observers_params_t::from_cmd_line( args ) } );
 	}
 	catch( const std::exception & ex )
 	{
@@ -91,4 +349,3 @@ int main()
 
 	return 0;
 }
-
@@ -1,19 +1,44 @@
 #include <dining_philosophers/actor_based/common/philosopher.hpp>
 #include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/fork_bitset.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/actor_based/common/launch.hpp>
+#include <dining_philosophers/actor_based/common/stats_collector.hpp>
+#include <dining_philosophers/actor_based/common/soak_mode.hpp>
 
 #include <fmt/format.h>
 
+#include <cstdint>
+
 // An actor for representing a waiter.
 //
 // This actor creates individual mboxes for "forks" and handles all messages
 // sent to those mboxes.
 //
+// In batch mode requests for left forks are not answered immediately.
+// They are collected and handled together by drain_t signal: the waiter
+// finds a maximal set of philosophers those can eat at the same time and
+// gives forks to all of them. Philosophers those can't eat stay in the
+// batch till the next drain (there are no 'busy' replies in this mode).
+//
 class waiter_t final : public so_5::agent_t
 {
+	// Signal for handling all collected requests.
+	struct drain_t final : public so_5::signal_t {};
+
 public :
-	waiter_t( context_t ctx, std::size_t forks_count )
+	waiter_t(
+		context_t ctx,
+		std::size_t forks_count,
+		const reply_table_t & replies,
+		bool batch_mode )
 		:	so_5::agent_t{ std::move(ctx) }
-		,	m_fork_states( forks_count, fork_state_t::free )
+		,	m_replies{ replies }
+		,	m_batch_mode{ batch_mode }
+		,	m_fork_states( forks_count )
+		,	m_eligible( forks_count )
+		,	m_queued( forks_count )
 	{
 		// Mboxes for every "fork" should be created.
 		m_fork_mboxes.reserve( forks_count );
@@ -43,41 +68,159 @@ public :
 						on_put_fork( std::move(cmd), i );
 					} );
 		}
+
+		so_subscribe_self().event( [this]( mhood_t<drain_t> ) {
+				drain();
+			} );
+	}
+
+	void so_evt_start() override
+	{
+		so_environment().stats_repository().add( m_wait_queue_stats );
+	}
+
+	void so_evt_finish() override
+	{
+		so_environment().stats_repository().remove( m_wait_queue_stats );
+
+		if( m_batch_mode )
+			fmt::print( "waiter: batches: {}, granted: {}, avg per batch: {:.2f}\n",
+					m_batches,
+					m_granted,
+					m_batches ? static_cast< double >( m_granted ) / m_batches : 0.0 );
 	}
 
 private :
-	// Every "fork" can be in one on these states.
-	enum class fork_state_t
+	// Mboxes of philosophers for replies.
+	const reply_table_t & m_replies;
+
+	const bool m_batch_mode;
+
+	// Indexes of handlers in m_timing.
+	enum timed_handler_t : std::size_t
 	{
-		free,
-		taken,
-		reserved
+		take,
+		put
 	};
 
+	handler_timing::table_t m_timing{ "waiter_t", { "take", "put" } };
+
 	// Mboxes for "forks".
 	std::vector< so_5::mbox_t > m_fork_mboxes;
 
 	// Current states for "forks".
-	std::vector< fork_state_t > m_fork_states;
+	fork_bitset_t m_fork_states;
 
 	// Queue for waiting philosophers. Every philisopher is identified by index.
+	// In batch mode it holds all collected requests in order of arrival.
 	std::vector< std::size_t > m_wait_queue;
 
+	// Is drain_t already sent?
+	bool m_drain_scheduled{ false };
+	// Philosophers those can get forks during the current drain.
+	fork_bitset_t::mask_t m_eligible;
+	// Philosophers from the wait queue.
+	fork_bitset_t::mask_t m_queued;
+
+	// Counters for batch mode.
+	std::uint64_t m_batches{};
+	std::uint64_t m_granted{};
+
+	// Length of the wait queue for run-time statistics.
+	quantity_source_t m_wait_queue_stats{ "waiter", "/wait_queue/size" };
+
 	// Actual handler for 'take' request.
 	void on_take_fork( mhood_t<take_t> cmd, std::size_t fork_index )
 	{
+		const auto measure = m_timing.measure( take, cmd );
+
 		// Use the fact that index of left fork is always equal to
 		// index of the philosopher itself.
-		if( fork_index == cmd->m_philosopher_index )
-			handle_take_left_fork( std::move(cmd), fork_index );
-		else
+		if( fork_index != cmd->m_philosopher_index )
 			handle_take_right_fork( std::move(cmd), fork_index );
+		else if( m_batch_mode )
+		{
+			m_wait_queue.push_back( cmd->m_philosopher_index );
+			m_wait_queue_stats.set( m_wait_queue.size() );
+			schedule_drain();
+		}
+		else
+			handle_take_left_fork( std::move(cmd), fork_index );
 	}
 
 	// Actual handler for 'put' request.
-	void on_put_fork( mhood_t<put_t>, std::size_t fork_index )
+	void on_put_fork( mhood_t<put_t> cmd, std::size_t fork_index )
+	{
+		const auto measure = m_timing.measure( put, cmd );
+
+		m_fork_states.set( fork_index, fork_state_t::free );
+		if( m_batch_mode && !m_wait_queue.empty() )
+			schedule_drain();
+	}
+
+	// All requests those are already in the event queue will be collected
+	// before drain_t is handled.
+	void schedule_drain()
 	{
-		m_fork_states[ fork_index ] = fork_state_t::free;
+		if( !m_drain_scheduled )
+		{
+			m_drain_scheduled = true;
+			so_5::send< drain_t >( *this );
+		}
+	}
+
+	// Gives forks to a maximal set of philosophers from the batch.
+	//
+	// Philosophers are checked in order of arrival. If a philosopher can't
+	// eat then his/her forks are blocked for the rest of the batch. So
+	// a philosopher can't be overtaken by a neighbor that came later.
+	//
+	// Philosophers those can eat are found for the whole table by
+	// word-wide operations. After that a philosopher (granted or not)
+	// only excludes both neighbors from the rest of the batch.
+	void drain()
+	{
+		m_drain_scheduled = false;
+
+		m_queued.reset();
+		for( const auto philosopher : m_wait_queue )
+			m_queued.set( philosopher, true );
+
+		m_fork_states.can_eat_mask( m_eligible );
+		m_eligible.intersect( m_queued );
+
+		// Nobody from the batch can eat now, so the whole batch has to wait.
+		if( !m_eligible.any() )
+			return;
+
+		++m_batches;
+
+		const auto forks_count = m_fork_states.size();
+
+		auto not_granted = m_wait_queue.begin();
+		for( const auto philosopher : m_wait_queue )
+		{
+			const auto left = philosopher;
+			const auto right = (philosopher + 1) % forks_count;
+
+			if( m_eligible.test( philosopher ) )
+			{
+				// The right fork is reserved until the next 'take' request.
+				m_fork_states.set( left, fork_state_t::taken );
+				m_fork_states.set( right, fork_state_t::reserved );
+				so_5::send< taken_t >( m_replies.reply_mbox( philosopher ) );
+				++m_granted;
+			}
+			else
+				*not_granted++ = philosopher;
+
+			// Forks of that philosopher are either taken or blocked.
+			m_eligible.set( (philosopher + forks_count - 1) % forks_count, false );
+			m_eligible.set( right, false );
+		}
+
+		m_wait_queue.erase( not_granted, m_wait_queue.end() );
+		m_wait_queue_stats.set( m_wait_queue.size() );
 	}
 
 	// Actual implementation of 'take' request for left fork.
@@ -85,9 +228,7 @@ private :
 	{
 		const auto right_fork_index = (left_fork_index + 1) % m_fork_states.size();
 		// Philopsoher can eat only if both fork are free now.
-		bool can_eat =
-				(fork_state_t::free == m_fork_states[ left_fork_index ]) &&
-				(fork_state_t::free == m_fork_states[ right_fork_index ]);
+		bool can_eat = m_fork_states.can_eat( left_fork_index );
 
 		if( can_eat )
 		{
@@ -106,6 +247,7 @@ private :
 					// We found ourselves before our neighbors.
 					// Remove ourselves from waiting queue and approve eating.
 					m_wait_queue.erase( it );
+					m_wait_queue_stats.set( m_wait_queue.size() );
 					break;
 				}
 				else if( left_neighbor == *it || right_neighbor == *it )
@@ -121,10 +263,11 @@ private :
 		{
 			// Both forks are free and there is no any neighbor before us in wait queue.
 			// Left fork will be taken to the requester right now.
-			m_fork_states[ left_fork_index ] = fork_state_t::taken;
+			m_fork_states.set( left_fork_index, fork_state_t::taken );
 			// But the right fork will be marked as reserver until next 'take' request.
-			m_fork_states[ right_fork_index ] = fork_state_t::reserved;
-			so_5::send< taken_t >( cmd->m_who );
+			m_fork_states.set( right_fork_index, fork_state_t::reserved );
+			so_5::send< taken_t >(
+					m_replies.reply_mbox( cmd->m_philosopher_index ) );
 		}
 		else
 		{
@@ -135,66 +278,111 @@ private :
 			{
 				// There is no that philosopher in the wait queue.
 				m_wait_queue.push_back( cmd->m_philosopher_index );
+				m_wait_queue_stats.set( m_wait_queue.size() );
 			}
 
-			so_5::send< busy_t >( cmd->m_who );
+			so_5::send< busy_t >(
+					m_replies.reply_mbox( cmd->m_philosopher_index ) );
 		}
 	}
 
 	// Actual implementation of 'take' request for right fork.
 	void handle_take_right_fork( mhood_t<take_t> cmd, std::size_t fork_index )
 	{
-		if( fork_state_t::reserved != m_fork_states[ fork_index ] )
+		if( fork_state_t::reserved != m_fork_states.state( fork_index ) )
 			throw std::runtime_error(
 					fmt::format( "unexpected state for right fork, state: {},"
 							" fork_index: {}, philosopher_index: {}",
-							static_cast<int>(m_fork_states[fork_index]),
+							static_cast<int>(m_fork_states.state( fork_index )),
 							fork_index,
 							cmd->m_philosopher_index ) );
 
-		m_fork_states[ fork_index ] = fork_state_t::taken;
-		so_5::send< taken_t >( cmd->m_who );
+		m_fork_states.set( fork_index, fork_state_t::taken );
+		so_5::send< taken_t >(
+				m_replies.reply_mbox( cmd->m_philosopher_index ) );
 	}
 };
 
 
-void run_simulation( so_5::environment_t & env, const names_holder_t & names )
+void run_simulation(
+	so_5::environment_t & env,
+	const names_holder_t & names,
+	bool single_threaded,
+	const stats_params_t & stats_params,
+	const soak_params_t & soak_params,
+	const trace::observers_params_t & observers_params,
+	bool batch_mode )
 {
 	env.introduce_coop( [&]( so_5::coop_t & coop ) {
-		coop.make_agent_with_binder< trace_maker_t >(
-				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+		make_trace_maker( coop,
+				auxiliary_binder( env, single_threaded ),
+				names,
+				soak_params );
+
+		make_trace_observers( coop,
+				auxiliary_binder( env, single_threaded ),
 				names,
-				random_pause_generator_t::trace_step() );
+				observers_params );
 
 		coop.make_agent_with_binder< completion_watcher_t >(
-				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				auxiliary_binder( env, single_threaded ),
 				names );
 
+		make_stats_collector( coop,
+				auxiliary_binder( env, single_threaded ),
+				stats_params );
+
 		const auto count = names.size();
 
-		auto * waiter = coop.make_agent< waiter_t >( count );
+		// Mboxes of philosophers for replies from the waiter.
+		auto * replies = coop.take_under_control(
+				std::make_unique< reply_table_t >( count ) );
+
+		auto * waiter = coop.make_agent< waiter_t >(
+				count, *replies, batch_mode );
 
 		for( std::size_t i{}; i != count; ++i )
-			coop.make_agent< philosopher_t >(
+		{
+			auto * philosopher = coop.make_agent< philosopher_t >(
 					i,
 					waiter->fork_mbox( i ),
 					waiter->fork_mbox( (i + 1) % count ),
-					default_meals_count );
+					soak_params.meals_count() );
+			replies->register_philosopher( i, philosopher->so_direct_mbox() );
+		}
 	});
 }
 
-int main()
+int main( int argc, char ** argv )
 {
 	try
 	{
+		const cmd_line_args_t args{ argc, argv };
+		// All agents work on one thread if `--single-threaded` is specified.
+		const bool single_threaded = args.has_flag( "--single-threaded" );
+		const auto stats_params = stats_params_t::from_cmd_line( args );
+		const auto soak_params = soak_params_t::from_cmd_line( args );
+		const auto observers_params =
+				trace::observers_params_t::from_cmd_line( args );
+		// Requests are handled in batches if `--batch` is specified.
+		const bool batch_mode = args.has_flag( "--batch" );
+
 		names_holder_t names{
 			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
 			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"	
 		};
 
-		so_5::launch( [&]( so_5::environment_t & env ) {
-				run_simulation( env, names );
-			} );
+		launch_simulation( single_threaded,
+				[&]( so_5::environment_t & env ) {
+					run_simulation( env, names, single_threaded,
+							stats_params, soak_params, observers_params,
+							batch_mode );
+				},
+				[&]( so_5::environment_params_t & params ) {
+					stats_params.tune( params );
+				} );
+
+		handler_timing::report();
 	}
 	catch( const std::exception & ex )
 	{
@@ -1,8 +1,71 @@
 #include <dining_philosophers/actor_based/common/philosopher.hpp>
 #include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/fork_bitset.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/actor_based/common/stats_collector.hpp>
+#include <dining_philosophers/actor_based/common/trace_observer_agent.hpp>
 
 #include <fmt/format.h>
 
+#include <array>
+
+// Class of service for a philosopher.
+//
+// The time of waiting of a philosopher is multiplied by the weight of
+// his/her class. So a philosopher of a higher class takes priority
+// earlier. But the priority grows for every waiting philosopher,
+// so philosophers of lower classes are not starved.
+enum class service_class_t : std::size_t
+{
+	latency_critical,
+	standard,
+	background
+};
+
+constexpr std::size_t service_classes_count = 3u;
+
+constexpr std::array< const char *, service_classes_count > service_class_names{
+	"latency_critical", "standard", "background"
+};
+
+// Weights are relative to the weight of the standard class.
+constexpr std::array< unsigned int, service_classes_count > service_class_weights{
+	4u, 2u, 1u
+};
+constexpr unsigned int standard_weight = 2u;
+
+using service_classes_t = std::vector< service_class_t >;
+
+// Every character of the pattern describes class of a philosopher:
+// 'c' for latency_critical, 's' for standard, 'b' for background.
+// The pattern is repeated if it is shorter than the count of philosophers.
+service_classes_t make_service_classes(
+	const std::string & pattern,
+	std::size_t philosophers_count )
+{
+	if( pattern.empty() )
+		throw std::invalid_argument( "empty pattern for service classes" );
+
+	service_classes_t result;
+	result.reserve( philosophers_count );
+	for( std::size_t i{}; i != philosophers_count; ++i )
+	{
+		const char c = pattern[ i % pattern.size() ];
+		switch( c )
+		{
+		case 'c': result.push_back( service_class_t::latency_critical ); break;
+		case 's': result.push_back( service_class_t::standard ); break;
+		case 'b': result.push_back( service_class_t::background ); break;
+		default:
+			throw std::invalid_argument(
+					fmt::format( "unknown service class: '{}'", c ) );
+		}
+	}
+
+	return result;
+}
+
 // An actor for representing a waiter.
 //
 // This actor creates individual mboxes for "forks" and handles all messages
@@ -14,12 +77,17 @@ public :
 	waiter_t(
 		context_t ctx,
 		std::size_t forks_count,
-		// Amount of time after that a philosopher should take a
-		// priority acquiring forks.
-		std::chrono::steady_clock::duration failures_threshold )
+		const reply_table_t & replies,
+		// Amount of time after that a philosopher of the standard class
+		// should take a priority acquiring forks.
+		std::chrono::steady_clock::duration failures_threshold,
+		// Class of service for every philosopher.
+		service_classes_t service_classes )
 		:	so_5::agent_t{ std::move(ctx) }
+		,	m_replies{ replies }
 		,	m_failures_threshold{ failures_threshold }
-		,	m_fork_states( forks_count, fork_state_t::free )
+		,	m_service_classes{ std::move(service_classes) }
+		,	m_fork_states( forks_count )
 		,	m_failures( forks_count, failure_info_t{} )
 	{
 		// Mboxes for every "fork" should be created.
@@ -52,15 +120,31 @@ public :
 		}
 	}
 
-private :
-	// Every "fork" can be in one on these states.
-	enum class fork_state_t
+	void so_evt_finish() override
 	{
-		free,
-		taken,
-		reserved
-	};
+		// Show the latency of serving for every class of service.
+		for( std::size_t i{}; i != service_classes_count; ++i )
+		{
+			const auto & stats = m_latencies[ i ];
+			if( !stats.m_grants )
+				continue;
+
+			const auto to_ms = []( auto d ) {
+				return std::chrono::duration_cast<
+						std::chrono::duration< double, std::milli > >( d ).count();
+			};
+
+			fmt::print( "{:>16}: meals: {}, delayed: {}, "
+					"avg wait: {:.1f}ms, max wait: {:.1f}ms\n",
+					service_class_names[ i ],
+					stats.m_grants,
+					stats.m_delayed,
+					to_ms( stats.m_total_wait / stats.m_grants ),
+					to_ms( stats.m_max_wait ) );
+		}
+	}
 
+private :
 	// Description of failures of a philosopher.
 	class failure_info_t
 	{
@@ -86,17 +170,29 @@ private :
 
 		void clear() noexcept { m_counter = 0u; }
 
+		// Time since the first failure multiplied by the weight of
+		// the class of service.
+		auto weighted_age(
+			std::chrono::steady_clock::time_point now,
+			unsigned int weight ) const noexcept
+		{
+			return (now - m_first_at) * weight / standard_weight;
+		}
+
 		// Return 'true' if 'a' has greater priority than 'b'.
 		// Failure info 'a' has greater priority of it really describes
-		// a failure and that failure happened before 'b'.
+		// a failure and that failure has greater weighted age than 'b'.
 		static bool has_greater_priority(
 			const failure_info_t & a,
-			const failure_info_t & b ) noexcept
+			unsigned int a_weight,
+			const failure_info_t & b,
+			unsigned int b_weight,
+			std::chrono::steady_clock::time_point now ) noexcept
 		{
-			// Time of the first failure can be compared if both 'a' and 'b'
+			// Weighted ages can be compared if both 'a' and 'b'
 			// holds information about failures.
 			if( a.actual() && b.actual() )
-				return a.earliest() < b.earliest();
+				return a.weighted_age( now, a_weight ) > b.weighted_age( now, b_weight );
 			else
 				// 'a' or 'b' (or both) has no actual failure info.
 				// Object 'a' will have greater priority only if 'a'
@@ -105,15 +201,45 @@ private :
 		}
 	};
 
-	// Amount of time after that a philosopher should take a
-	// priority acquiring forks.
+	// Mboxes of philosophers for replies.
+	const reply_table_t & m_replies;
+
+	// Indexes of handlers in m_timing.
+	enum timed_handler_t : std::size_t
+	{
+		take,
+		put
+	};
+
+	handler_timing::table_t m_timing{ "waiter_t", { "take", "put" } };
+
+	// Statistics of serving for one class of service.
+	struct latency_stats_t
+	{
+		// Count of approved requests.
+		std::size_t m_grants{};
+		// Count of approved requests those had failures before.
+		std::size_t m_delayed{};
+		// Time between the first failure and the approval.
+		std::chrono::steady_clock::duration m_total_wait{};
+		std::chrono::steady_clock::duration m_max_wait{};
+	};
+
+	// Amount of time after that a philosopher of the standard class
+	// should take a priority acquiring forks.
 	const std::chrono::steady_clock::duration m_failures_threshold;
 
+	// Class of service for every philosopher.
+	const service_classes_t m_service_classes;
+
+	// Statistics for every class of service.
+	std::array< latency_stats_t, service_classes_count > m_latencies;
+
 	// Mboxes for "forks".
 	std::vector< so_5::mbox_t > m_fork_mboxes;
 
 	// Current states for "forks".
-	std::vector< fork_state_t > m_fork_states;
+	fork_bitset_t m_fork_states;
 
 	// Information of philisophers' failuers.
 	// Every item in that vector related to the corresponding philosopher.
@@ -122,6 +248,8 @@ private :
 	// Actual handler for 'take' request.
 	void on_take_fork( mhood_t<take_t> cmd, std::size_t fork_index )
 	{
+		const auto measure = m_timing.measure( take, cmd );
+
 		// Use the fact that index of left fork is always equal to
 		// index of the philosopher itself.
 		if( fork_index == cmd->m_philosopher_index )
@@ -131,9 +259,11 @@ private :
 	}
 
 	// Actual handler for 'put' request.
-	void on_put_fork( mhood_t<put_t>, std::size_t fork_index )
+	void on_put_fork( mhood_t<put_t> cmd, std::size_t fork_index )
 	{
-		m_fork_states[ fork_index ] = fork_state_t::free;
+		const auto measure = m_timing.measure( put, cmd );
+
+		m_fork_states.set( fork_index, fork_state_t::free );
 	}
 
 	// Actual implementation of 'take' request for left fork.
@@ -143,9 +273,7 @@ private :
 	{
 		const auto right_fork_index = (left_fork_index + 1) % m_fork_states.size();
 		// Philopsoher can eat only if both fork are free now.
-		bool can_eat =
-				(fork_state_t::free == m_fork_states[ left_fork_index ]) &&
-				(fork_state_t::free == m_fork_states[ right_fork_index ]);
+		bool can_eat = m_fork_states.can_eat( left_fork_index );
 
 		if( can_eat )
 		{
@@ -171,48 +299,77 @@ private :
 		{
 			// Both forks are free and there is no any neighbor with greater priority.
 			// We can allow the requester to eat.
+			update_latency_stats( cmd->m_philosopher_index );
 			// All previous information about failures no more relevant.
 			m_failures[ cmd->m_philosopher_index ].clear();
 
 			// Left fork will be taken to the requester right now.
-			m_fork_states[ left_fork_index ] = fork_state_t::taken;
+			m_fork_states.set( left_fork_index, fork_state_t::taken );
 			// But the right fork will be marked as reserver until next 'take' request.
-			m_fork_states[ right_fork_index ] = fork_state_t::reserved;
+			m_fork_states.set( right_fork_index, fork_state_t::reserved );
 
-			so_5::send< taken_t >( cmd->m_who );
+			so_5::send< taken_t >(
+					m_replies.reply_mbox( cmd->m_philosopher_index ) );
 		}
 		else
 		{
 			// Failures info should be update for the requester.
 			m_failures[ cmd->m_philosopher_index ].increment();
 
-			so_5::send< busy_t >( cmd->m_who );
+			so_5::send< busy_t >(
+					m_replies.reply_mbox( cmd->m_philosopher_index ) );
 		}
 	}
 
 	// Actual implementation of 'take' request for right fork.
 	void handle_take_right_fork( mhood_t<take_t> cmd, std::size_t fork_index )
 	{
-		if( fork_state_t::reserved != m_fork_states[ fork_index ] )
+		if( fork_state_t::reserved != m_fork_states.state( fork_index ) )
 			throw std::runtime_error(
 					fmt::format( "unexpected state for right fork, state: {},"
 							" fork_index: {}, philosopher_index: {}",
-							static_cast<int>(m_fork_states[fork_index]),
+							static_cast<int>(m_fork_states.state( fork_index )),
 							fork_index,
 							cmd->m_philosopher_index ) );
 
-		m_fork_states[ fork_index ] = fork_state_t::taken;
-		so_5::send< taken_t >( cmd->m_who );
+		m_fork_states.set( fork_index, fork_state_t::taken );
+		so_5::send< taken_t >(
+				m_replies.reply_mbox( cmd->m_philosopher_index ) );
+	}
+
+	unsigned int weight_of( std::size_t philosopher_index ) const noexcept
+	{
+		return service_class_weights[ static_cast< std::size_t >(
+				m_service_classes[ philosopher_index ] ) ];
+	}
+
+	void update_latency_stats( std::size_t philosopher_index )
+	{
+		auto & stats = m_latencies[ static_cast< std::size_t >(
+				m_service_classes[ philosopher_index ] ) ];
+		++stats.m_grants;
+
+		const auto & failures = m_failures[ philosopher_index ];
+		if( failures.actual() )
+		{
+			const auto wait = std::chrono::steady_clock::now() - failures.earliest();
+			++stats.m_delayed;
+			stats.m_total_wait += wait;
+			stats.m_max_wait = std::max( stats.m_max_wait, wait );
+		}
 	}
 
 	// Should this failure info be considered at all?
 	// Content of 'info' should be considered only if 'info' contains
-	// information about actual failure and appropriate amount of time passed
-	// since the first failure.
-	bool should_be_considered( const failure_info_t & info ) const noexcept
+	// information about actual failure and appropriate amount of weighted
+	// time passed since the first failure.
+	bool should_be_considered(
+		const failure_info_t & info,
+		unsigned int weight,
+		std::chrono::steady_clock::time_point now ) const noexcept
 	{
 		if( info.actual() )
-			return info.earliest() + m_failures_threshold < std::chrono::steady_clock::now();
+			return m_failures_threshold < info.weighted_age( now, weight );
 
 		return false;
 	}
@@ -223,16 +380,21 @@ private :
 		std::size_t requester_index,
 		std::size_t neighbor_index ) const noexcept
 	{
+		const auto now = std::chrono::steady_clock::now();
+		const auto neighbor_weight = weight_of( neighbor_index );
 		const auto & neighbor_failures = m_failures[ neighbor_index ];
-		if( should_be_considered( neighbor_failures ) )
+		if( should_be_considered( neighbor_failures, neighbor_weight, now ) )
 		{
+			const auto requester_weight = weight_of( requester_index );
 			const auto & requester_failures = m_failures[ requester_index ];
-			if( should_be_considered( requester_failures ) )
+			if( should_be_considered( requester_failures, requester_weight, now ) )
 			{
 				// Neighbor and requester have actual failure infos.
 				// The result will depend on the content of that information.
 				return failure_info_t::has_greater_priority(
-						requester_failures, neighbor_failures );
+						requester_failures, requester_weight,
+						neighbor_failures, neighbor_weight,
+						now );
 			}
 			else
 				// Neighbor has actual failure info, but requester hasn't.
@@ -247,7 +409,12 @@ private :
 };
 
 
-void run_simulation( so_5::environment_t & env, const names_holder_t & names )
+void run_simulation(
+	so_5::environment_t & env,
+	const names_holder_t & names,
+	const service_classes_t & service_classes,
+	const stats_params_t & stats_params,
+	const trace::observers_params_t & observers_params )
 {
 	env.introduce_coop( [&]( so_5::coop_t & coop ) {
 		coop.make_agent_with_binder< trace_maker_t >(
@@ -255,37 +422,73 @@ void run_simulation( so_5::environment_t & env, const names_holder_t & names )
 				names,
 				random_pause_generator_t::trace_step() );
 
+		make_trace_observers( coop,
+				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				names,
+				observers_params );
+
 		coop.make_agent_with_binder< completion_watcher_t >(
 				so_5::disp::one_thread::make_dispatcher( env ).binder(),
 				names );
 
+		make_stats_collector( coop,
+				so_5::disp::one_thread::make_dispatcher( env ).binder(),
+				stats_params );
+
 		const auto count = names.size();
 
+		// Mboxes of philosophers for replies from the waiter.
+		auto * replies = coop.take_under_control(
+				std::make_unique< reply_table_t >( count ) );
+
 		auto * waiter = coop.make_agent< waiter_t >(
 				count,
-				std::chrono::milliseconds(50) );
+				*replies,
+				std::chrono::milliseconds(50),
+				service_classes );
 
 		for( std::size_t i{}; i != count; ++i )
-			coop.make_agent< philosopher_t >(
+		{
+			auto * philosopher = coop.make_agent< philosopher_t >(
 					i,
 					waiter->fork_mbox( i ),
 					waiter->fork_mbox( (i + 1) % count ),
 					default_meals_count );
+			replies->register_philosopher( i, philosopher->so_direct_mbox() );
+		}
 	});
 }
 
-int main()
+int main( int argc, char ** argv )
 {
 	try
 	{
+		const cmd_line_args_t args{ argc, argv };
+
 		names_holder_t names{
 			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
 			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"	
 		};
 
-		so_5::launch( [&]( so_5::environment_t & env ) {
-				run_simulation( env, names );
-			} );
+		// Classes of service can be set by `--classes PATTERN` option.
+		// All philosophers are of the standard class by default.
+		const auto service_classes = make_service_classes(
+				args.value_or( "--classes", "s" ), names.size() );
+
+		const auto stats_params = stats_params_t::from_cmd_line( args );
+		const auto observers_params =
+				trace::observers_params_t::from_cmd_line( args );
+
+		so_5::launch(
+				[&]( so_5::environment_t & env ) {
+					run_simulation( env, names, service_classes,
+							stats_params, observers_params );
+				},
+				[&]( so_5::environment_params_t & params ) {
+					stats_params.tune( params );
+				} );
+
+		handler_timing::report();
 	}
 	catch( const std::exception & ex )
 	{
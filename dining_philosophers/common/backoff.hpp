@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+//
+// backoff_policy_t
+//
+// How the duration of hungry thinking is chosen after a failed
+// attempt to take forks.
+enum class backoff_policy_t
+{
+	// Every attempt uses a fresh uniform pause from the same range.
+	uniform,
+	// The upper bound of the pause is doubled after every consecutive
+	// failure. The actual pause is randomly chosen below that bound.
+	exponential,
+	// The upper bound of the pause follows the recent ratio of failed
+	// attempts: the more busy replies, the longer the pause.
+	adaptive
+};
+
+inline backoff_policy_t backoff_policy_from_string( const std::string & name )
+{
+	if( "uniform" == name ) return backoff_policy_t::uniform;
+	if( "exponential" == name ) return backoff_policy_t::exponential;
+	if( "adaptive" == name ) return backoff_policy_t::adaptive;
+
+	throw std::invalid_argument( "unknown backoff policy: " + name );
+}
+
+//
+// hungry_backoff_t
+//
+// Keeps the history of attempts to take forks and calculates the range
+// for the next hungry thinking pause.
+//
+class hungry_backoff_t
+{
+public :
+	explicit hungry_backoff_t( backoff_policy_t policy ) noexcept
+		:	m_policy{ policy }
+	{}
+
+	// An attempt to take a fork failed.
+	void on_busy() noexcept
+	{
+		if( m_consecutive_failures < max_doublings )
+			++m_consecutive_failures;
+
+		m_busy_ratio += smoothing * (1.0 - m_busy_ratio);
+	}
+
+	// Both forks are taken.
+	void on_success() noexcept
+	{
+		m_consecutive_failures = 0u;
+
+		m_busy_ratio -= smoothing * m_busy_ratio;
+	}
+
+	// Bounds (in milliseconds) for the next hungry thinking pause.
+	std::pair< int, int > pause_bounds() const noexcept
+	{
+		switch( m_policy )
+		{
+		case backoff_policy_t::uniform :
+		break;
+
+		case backoff_policy_t::exponential :
+			if( m_consecutive_failures )
+				return { min_pause,
+						std::min( max_pause,
+								initial_max_pause << (m_consecutive_failures - 1u) ) };
+		break;
+
+		case backoff_policy_t::adaptive :
+			return { min_pause,
+					initial_max_pause + static_cast<int>(
+							m_busy_ratio * (max_pause - initial_max_pause) ) };
+		}
+
+		return { min_pause, initial_max_pause };
+	}
+
+private :
+	// Range of the pause for the very first failure.
+	// It is the same range that is used by the uniform policy.
+	static constexpr int min_pause = 10;
+	static constexpr int initial_max_pause = 30;
+	// The limit for the upper bound of the pause.
+	static constexpr int max_pause = 480;
+	// There is no need to count failures above that value because
+	// the upper bound of the pause is already limited by max_pause.
+	static constexpr unsigned int max_doublings = 5u;
+	// Weight of the last attempt in m_busy_ratio.
+	static constexpr double smoothing = 0.25;
+
+	const backoff_policy_t m_policy;
+
+	// Count of failed attempts since the last success.
+	unsigned int m_consecutive_failures{};
+
+	// Exponential moving average of busy replies.
+	double m_busy_ratio{};
+};
+
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <vector>
+
+//
+// cmd_line_args_t
+//
+// Very simple holder for command line arguments.
+// Options are expected in form `--name value`, flags in form `--name`.
+//
+class cmd_line_args_t
+{
+public :
+	cmd_line_args_t( int argc, char ** argv )
+		:	m_args( argv + 1, argv + argc )
+	{}
+
+	bool has_flag( const std::string & name ) const
+	{
+		return m_args.end() != std::find( m_args.begin(), m_args.end(), name );
+	}
+
+	std::optional< std::string > value_of( const std::string & name ) const
+	{
+		auto it = std::find( m_args.begin(), m_args.end(), name );
+		if( it == m_args.end() || ++it == m_args.end() )
+			return std::nullopt;
+
+		return *it;
+	}
+
+	std::string value_or(
+		const std::string & name,
+		std::string default_value ) const
+	{
+		auto v = value_of( name );
+		return v ? std::move(*v) : std::move(default_value);
+	}
+
+private :
+	const std::vector< std::string > m_args;
+};
+
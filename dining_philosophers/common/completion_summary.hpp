@@ -0,0 +1,66 @@
+#pragma once
+
+#include <dining_philosophers/common/types.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+
+//
+// completion_summary_t
+//
+// Aggregates notifications about completed philosophers, so there is no
+// need to print a line for every philosopher of a huge table.
+//
+// Only a sample of philosophers is shown: every philosopher if the table
+// isn't greater than the sample size, or philosophers with a step in
+// indexes otherwise.
+//
+class completion_summary_t
+{
+public :
+	static constexpr std::size_t default_sample_size = 16u;
+
+	explicit completion_summary_t(
+		std::size_t philosophers_count,
+		// Zero means that no one is shown.
+		std::size_t sample_size = default_sample_size ) noexcept
+		:	m_sample_step{ sample_size ?
+				std::max< std::size_t >( 1u,
+						(philosophers_count + sample_size - 1u) / sample_size ) :
+				std::size_t{} }
+	{}
+
+	void add( const philosopher_done_t & info ) noexcept
+	{
+		++m_completed;
+		m_busy_replies += info.m_busy_replies;
+		m_timeouts += info.m_timeouts;
+		m_max_busy_replies = std::max( m_max_busy_replies, info.m_busy_replies );
+	}
+
+	bool is_sampled( std::size_t philosopher_index ) const noexcept
+	{
+		return m_sample_step && 0u == philosopher_index % m_sample_step;
+	}
+
+	std::size_t completed() const noexcept { return m_completed; }
+
+	void show() const
+	{
+		fmt::print( "completed: {}, busy replies: {} (max {}), timeouts: {}\n",
+				m_completed,
+				m_busy_replies,
+				m_max_busy_replies,
+				m_timeouts );
+	}
+
+private :
+	const std::size_t m_sample_step;
+
+	std::size_t m_completed{};
+	std::uint64_t m_busy_replies{};
+	std::uint64_t m_timeouts{};
+	unsigned int m_max_busy_replies{};
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//
+// conflict_graph_t
+//
+// Resources needed by every process (drinking philosophers problem).
+// Two processes are in conflict if they need the same resource.
+//
+// Resources of a process are sorted in ascending order.
+//
+struct conflict_graph_t
+{
+	std::size_t m_resources_count{};
+	std::vector< std::vector< std::size_t > > m_needs;
+
+	std::size_t processes_count() const noexcept { return m_needs.size(); }
+};
+
+namespace conflict_graph {
+
+namespace details {
+
+inline void normalize( conflict_graph_t & graph )
+{
+	for( auto & needs : graph.m_needs )
+	{
+		std::sort( needs.begin(), needs.end() );
+		needs.erase( std::unique( needs.begin(), needs.end() ), needs.end() );
+		if( needs.empty() )
+			throw std::invalid_argument( "process without resources" );
+
+		graph.m_resources_count =
+				std::max( graph.m_resources_count, needs.back() + 1u );
+	}
+}
+
+// Every process takes k distinct resources with the given distribution.
+template< typename Distribution >
+conflict_graph_t make_with_distribution(
+	std::size_t processes,
+	std::size_t resources,
+	std::size_t k,
+	unsigned seed,
+	Distribution && distribution )
+{
+	if( k > resources )
+		throw std::invalid_argument( "k is greater than count of resources" );
+
+	std::mt19937 engine{ seed };
+
+	conflict_graph_t graph;
+	graph.m_needs.resize( processes );
+	for( auto & needs : graph.m_needs )
+		while( needs.size() != k )
+		{
+			const auto r = static_cast< std::size_t >( distribution( engine ) );
+			if( needs.end() == std::find( needs.begin(), needs.end(), r ) )
+				needs.push_back( r );
+		}
+
+	normalize( graph );
+	return graph;
+}
+
+} /* namespace details */
+
+// Loads the graph from a text file. Every non-empty line that doesn't
+// start with '#' describes a process: indexes of resources needed by it.
+//
+// # Three processes and four resources.
+// 0 1
+// 1 2 3
+// 3 0
+//
+inline conflict_graph_t load( const std::string & file_name )
+{
+	std::ifstream file{ file_name };
+	if( !file )
+		throw std::runtime_error( "unable to open graph file: " + file_name );
+
+	conflict_graph_t graph;
+	std::string line;
+	while( std::getline( file, line ) )
+	{
+		std::istringstream s{ line };
+		s >> std::ws;
+		if( s.eof() || '#' == s.peek() )
+			continue;
+
+		std::vector< std::size_t > needs;
+		std::size_t r;
+		while( s >> r )
+			needs.push_back( r );
+		if( !s.eof() )
+			throw std::invalid_argument( "invalid line in graph file: " + line );
+
+		graph.m_needs.push_back( std::move(needs) );
+	}
+
+	if( graph.m_needs.empty() )
+		throw std::invalid_argument( "graph file is empty: " + file_name );
+
+	details::normalize( graph );
+	return graph;
+}
+
+// Every process needs k resources chosen uniformly.
+inline conflict_graph_t make_random(
+	std::size_t processes,
+	std::size_t resources,
+	std::size_t k,
+	unsigned seed )
+{
+	return details::make_with_distribution( processes, resources, k, seed,
+			std::uniform_int_distribution< std::size_t >{ 0u, resources - 1u } );
+}
+
+// Popularity of resources follows the power law: resource r is chosen
+// with the probability proportional to 1/(r+1). So there are few
+// "hot" resources needed by many processes.
+inline conflict_graph_t make_power_law(
+	std::size_t processes,
+	std::size_t resources,
+	std::size_t k,
+	unsigned seed )
+{
+	std::vector< double > weights( resources );
+	for( std::size_t r{}; r != resources; ++r )
+		weights[ r ] = 1.0 / static_cast< double >( r + 1u );
+
+	return details::make_with_distribution( processes, resources, k, seed,
+			std::discrete_distribution< std::size_t >{
+					weights.begin(), weights.end() } );
+}
+
+// Processes are cells of width x height grid (with wrapping), resources
+// are edges between neighbor cells. Every process needs four resources.
+// The classic ring is the grid with height 1 (with two resources
+// per process).
+inline conflict_graph_t make_grid( std::size_t width, std::size_t height )
+{
+	if( width < 2u )
+		throw std::invalid_argument( "width of grid should be at least 2" );
+
+	const auto cell = [width]( std::size_t x, std::size_t y ) {
+		return y * width + x;
+	};
+
+	conflict_graph_t graph;
+	graph.m_needs.resize( width * height );
+	// Horizontal edges are numbered first, vertical ones after them.
+	const auto horizontal = width * height;
+	for( std::size_t y{}; y != height; ++y )
+		for( std::size_t x{}; x != width; ++x )
+		{
+			const auto c = cell( x, y );
+			// Edge to the right neighbor.
+			graph.m_needs[ c ].push_back( c );
+			graph.m_needs[ cell( (x + 1u) % width, y ) ].push_back( c );
+
+			if( height > 1u )
+			{
+				// Edge to the bottom neighbor.
+				graph.m_needs[ c ].push_back( horizontal + c );
+				graph.m_needs[ cell( x, (y + 1u) % height ) ].push_back(
+						horizontal + c );
+			}
+		}
+
+	details::normalize( graph );
+	return graph;
+}
+
+// Grid that is close to a square for the given count of processes.
+inline conflict_graph_t make_square_grid( std::size_t processes )
+{
+	const auto side = std::max< std::size_t >( 2u,
+			static_cast< std::size_t >( std::lround(
+					std::sqrt( static_cast< double >( processes ) ) ) ) );
+	return make_grid( side, std::max< std::size_t >( 1u, processes / side ) );
+}
+
+} /* namespace conflict_graph */
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+#if defined(_WIN32)
+	#if !defined(NOMINMAX)
+		#define NOMINMAX
+	#endif
+	#if !defined(WIN32_LEAN_AND_MEAN)
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+	#include <sys/resource.h>
+#endif
+
+namespace cpu_time {
+
+using duration_t = std::chrono::duration< double >;
+
+// CPU time (user and system) of all threads of the current process.
+// It's supported on Windows and POSIX platforms, an empty value is
+// returned on other platforms.
+inline std::optional< duration_t > process_time()
+{
+#if defined(_WIN32)
+	FILETIME creation, exit, kernel, user;
+	if( GetProcessTimes( GetCurrentProcess(), &creation, &exit, &kernel, &user ) )
+	{
+		// FILETIME is measured in 100ns intervals.
+		const auto to_seconds = []( const FILETIME & t ) {
+			return static_cast< double >(
+					(static_cast< unsigned long long >( t.dwHighDateTime ) << 32u) |
+					t.dwLowDateTime ) / 1e7;
+		};
+		return duration_t{ to_seconds( kernel ) + to_seconds( user ) };
+	}
+#elif defined(__unix__) || defined(__APPLE__)
+	rusage usage{};
+	if( 0 == getrusage( RUSAGE_SELF, &usage ) )
+	{
+		const auto to_seconds = []( const timeval & t ) {
+			return static_cast< double >( t.tv_sec ) +
+					static_cast< double >( t.tv_usec ) / 1e6;
+		};
+		return duration_t{
+				to_seconds( usage.ru_utime ) + to_seconds( usage.ru_stime ) };
+	}
+#endif
+	return std::nullopt;
+}
+
+} /* namespace cpu_time */
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <limits>
+
 // Count of meals for simulation.
 constexpr int default_meals_count = 15;
 
+// Count of meals for endless runs. Philosophers won't finish it in
+// any realistic time.
+constexpr int unlimited_meals_count = std::numeric_limits< int >::max();
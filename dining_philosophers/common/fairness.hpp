@@ -0,0 +1,280 @@
+#pragma once
+
+#include <dining_philosophers/common/trace.hpp>
+#include <dining_philosophers/common/trace_observer.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace trace {
+
+//
+// fairness_params_t
+//
+struct fairness_params_t
+{
+	bool m_enabled;
+	// Length of the sliding window.
+	std::chrono::milliseconds m_window;
+
+	// Metrics are turned on by `--fairness` flag. The length of the window
+	// can be set by `--fairness-window MILLISECONDS` option.
+	static fairness_params_t from_cmd_line( const cmd_line_args_t & args )
+	{
+		return {
+			args.has_flag( "--fairness" ),
+			std::chrono::milliseconds{ std::stoul(
+					args.value_or( "--fairness-window", "1000" ) ) }
+		};
+	}
+
+	// The window slides with that step.
+	std::chrono::milliseconds step() const noexcept
+	{
+		return std::max( std::chrono::milliseconds{ 1 },
+				m_window / window_buckets );
+	}
+
+	static constexpr unsigned window_buckets = 4u;
+};
+
+//
+// fairness_values_t
+//
+// Meals and waiting times of philosophers for some period of time.
+//
+struct fairness_values_t
+{
+	std::vector< std::uint64_t > m_meals;
+	// Total time of waiting for forks (from the first attempt to take
+	// the left fork till the start of eating).
+	std::vector< std::chrono::steady_clock::duration > m_waiting;
+
+	explicit fairness_values_t( std::size_t count )
+		:	m_meals( count )
+		,	m_waiting( count )
+	{}
+
+	void clear()
+	{
+		std::fill( m_meals.begin(), m_meals.end(), 0u );
+		std::fill( m_waiting.begin(), m_waiting.end(),
+				std::chrono::steady_clock::duration::zero() );
+	}
+
+	void add( const fairness_values_t & other )
+	{
+		for( std::size_t i{}; i != m_meals.size(); ++i )
+		{
+			m_meals[ i ] += other.m_meals[ i ];
+			m_waiting[ i ] += other.m_waiting[ i ];
+		}
+	}
+};
+
+namespace fairness {
+
+// Jain's index: (sum x)^2 / (n * sum x^2). It is 1 if all values are
+// equal and 1/n if only one value isn't zero.
+inline double jain_index( const std::vector< double > & values )
+{
+	double sum{};
+	double sum_of_squares{};
+	for( const auto v : values )
+	{
+		sum += v;
+		sum_of_squares += v * v;
+	}
+
+	if( 0.0 == sum_of_squares )
+		return 1.0;
+
+	return sum * sum / (static_cast< double >( values.size() ) * sum_of_squares);
+}
+
+// Gini coefficient. It is 0 if all values are equal.
+inline double gini( std::vector< double > values )
+{
+	std::sort( values.begin(), values.end() );
+
+	double sum{};
+	double weighted_sum{};
+	for( std::size_t i{}; i != values.size(); ++i )
+	{
+		sum += values[ i ];
+		weighted_sum += static_cast< double >( i + 1u ) * values[ i ];
+	}
+
+	if( 0.0 == sum )
+		return 0.0;
+
+	const auto n = static_cast< double >( values.size() );
+	return 2.0 * weighted_sum / (n * sum) - (n + 1.0) / n;
+}
+
+// Ratio of the max value to the min one.
+inline double max_min_ratio( const std::vector< double > & values )
+{
+	const auto [min, max] = std::minmax_element( values.begin(), values.end() );
+	if( 0.0 == *min )
+		return 0.0 == *max ? 1.0 : std::numeric_limits< double >::infinity();
+
+	return *max / *min;
+}
+
+} /* namespace fairness */
+
+//
+// fairness_meter_t
+//
+// Online fairness metrics:
+// - Jain's index for counts of meals;
+// - ratio of the max count of meals to the min one;
+// - Gini coefficient for waiting times.
+//
+// Metrics for the sliding window are shown on every step of the window.
+// Metrics for the whole run are shown at the end. Philosophers those have
+// completed their work are not taken into account for the window.
+//
+class fairness_meter_t final : public observer_t
+{
+public :
+	fairness_meter_t(
+		const names_holder_t & names,
+		const fairness_params_t & params )
+		:	m_params{ params }
+		,	m_philosophers( names.size() )
+		,	m_buckets(
+				fairness_params_t::window_buckets,
+				fairness_values_t{ names.size() } )
+		,	m_total{ names.size() }
+		,	m_next_step_at{ std::chrono::steady_clock::now() + params.step() }
+	{}
+
+	void on_state_changed(
+		std::size_t index,
+		char state,
+		std::chrono::steady_clock::time_point when ) override
+	{
+		auto & p = m_philosophers[ index ];
+		switch( state )
+		{
+		case st_wait_left:
+			if( !p.m_hungry )
+			{
+				p.m_hungry = true;
+				p.m_hungry_since = when;
+			}
+		break;
+
+		case st_eating:
+		{
+			auto & bucket = m_buckets[ m_current ];
+			++bucket.m_meals[ index ];
+			if( p.m_hungry )
+			{
+				p.m_hungry = false;
+				bucket.m_waiting[ index ] += when - p.m_hungry_since;
+			}
+		}
+		break;
+
+		case st_done:
+			p.m_done = true;
+		break;
+
+		default: break;
+		}
+	}
+
+	void on_tick( std::chrono::steady_clock::time_point now ) override
+	{
+		if( now < m_next_step_at )
+			return;
+
+		m_next_step_at = now + m_params.step();
+
+		fairness_values_t window{ m_philosophers.size() };
+		for( const auto & b : m_buckets )
+			window.add( b );
+
+		++m_steps;
+		// Metrics aren't shown until the window is filled.
+		if( m_steps >= m_buckets.size() )
+			show( fmt::format( "last {}ms", m_params.m_window.count() ),
+					window,
+					true );
+
+		// The oldest bucket becomes the current one.
+		m_current = (m_current + 1u) % m_buckets.size();
+		m_total.add( m_buckets[ m_current ] );
+		m_buckets[ m_current ].clear();
+	}
+
+	void on_finish( std::chrono::steady_clock::time_point /*now*/ ) override
+	{
+		for( const auto & b : m_buckets )
+			m_total.add( b );
+
+		show( "whole run", m_total, false );
+	}
+
+private :
+	struct philosopher_t
+	{
+		bool m_hungry{ false };
+		std::chrono::steady_clock::time_point m_hungry_since;
+		bool m_done{ false };
+	};
+
+	const fairness_params_t m_params;
+
+	std::vector< philosopher_t > m_philosophers;
+
+	// Ring of buckets of the sliding window.
+	std::vector< fairness_values_t > m_buckets;
+	std::size_t m_current{};
+	std::size_t m_steps{};
+
+	// Values from buckets those have left the window.
+	fairness_values_t m_total;
+
+	std::chrono::steady_clock::time_point m_next_step_at;
+
+	void show(
+		const std::string & period,
+		const fairness_values_t & values,
+		bool skip_done ) const
+	{
+		std::vector< double > meals;
+		std::vector< double > waiting;
+		std::uint64_t total_meals{};
+		for( std::size_t i{}; i != m_philosophers.size(); ++i )
+		{
+			if( skip_done && m_philosophers[ i ].m_done )
+				continue;
+
+			meals.push_back( static_cast< double >( values.m_meals[ i ] ) );
+			waiting.push_back( std::chrono::duration< double >(
+					values.m_waiting[ i ] ).count() );
+			total_meals += values.m_meals[ i ];
+		}
+
+		if( meals.empty() )
+			return;
+
+		fmt::print( "fairness [{}]: meals: {}, jain index: {:.3f}, "
+				"max/min meals: {:.2f}, waiting gini: {:.3f}\n",
+				period,
+				total_meals,
+				fairness::jain_index( meals ),
+				fairness::max_min_ratio( meals ),
+				fairness::gini( waiting ) );
+	}
+};
+
+} /* namespace trace */
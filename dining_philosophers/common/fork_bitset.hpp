@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+//
+// fork_state_t
+//
+// A state of a fork owned by a waiter.
+//
+enum class fork_state_t
+{
+	free,
+	taken,
+	// The fork is kept for the philosopher that has taken the left fork
+	// and will request the right one.
+	reserved
+};
+
+//
+// fork_bitset_t
+//
+// States of all forks of a table stored as two bitsets: one for free forks
+// and one for reserved forks (a fork that is neither free nor reserved is
+// taken).
+//
+// Philosophers those can eat right now (both forks are free) are found
+// by word-wide operations: `free & (free >> 1)` with carrying of bits
+// between words and wrapping around the table. The result is a mask_t
+// that can be combined with other sets of philosophers. Loops over words
+// are simple enough to be vectorized by compilers.
+//
+// Philosopher i uses forks i and (i+1) % size().
+//
+class fork_bitset_t
+{
+	using word_t = std::uint64_t;
+	static constexpr std::size_t word_bits = 64u;
+
+public :
+	//
+	// mask_t
+	//
+	// A set of philosophers of the table (bit i is philosopher i).
+	//
+	class mask_t
+	{
+		friend class fork_bitset_t;
+
+	public :
+		explicit mask_t( std::size_t count )
+			:	m_words( (count + word_bits - 1u) / word_bits, word_t{} )
+		{}
+
+		bool test( std::size_t i ) const noexcept
+		{
+			return fork_bitset_t::test( m_words, i );
+		}
+
+		void set( std::size_t i, bool value ) noexcept
+		{
+			assign( m_words, i, value );
+		}
+
+		void reset() noexcept
+		{
+			std::fill( m_words.begin(), m_words.end(), word_t{} );
+		}
+
+		void intersect( const mask_t & other ) noexcept
+		{
+			for( std::size_t w{}; w != m_words.size(); ++w )
+				m_words[ w ] &= other.m_words[ w ];
+		}
+
+		bool any() const noexcept
+		{
+			for( const auto w : m_words )
+				if( w )
+					return true;
+			return false;
+		}
+
+	private :
+		std::vector< word_t > m_words;
+	};
+
+	explicit fork_bitset_t( std::size_t forks_count )
+		:	m_size{ forks_count }
+		,	m_free( (forks_count + word_bits - 1u) / word_bits, ~word_t{} )
+		,	m_reserved( m_free.size(), word_t{} )
+	{
+		// Bits outside of the table should be zero.
+		const auto tail = m_size % word_bits;
+		if( tail )
+			m_free.back() = (word_t{1} << tail) - 1u;
+	}
+
+	std::size_t size() const noexcept { return m_size; }
+
+	fork_state_t state( std::size_t fork ) const noexcept
+	{
+		if( test( m_free, fork ) )
+			return fork_state_t::free;
+		return test( m_reserved, fork ) ? fork_state_t::reserved : fork_state_t::taken;
+	}
+
+	bool is_free( std::size_t fork ) const noexcept
+	{
+		return test( m_free, fork );
+	}
+
+	void set( std::size_t fork, fork_state_t state ) noexcept
+	{
+		assign( m_free, fork, fork_state_t::free == state );
+		assign( m_reserved, fork, fork_state_t::reserved == state );
+	}
+
+	// Both forks of the philosopher are free.
+	bool can_eat( std::size_t philosopher ) const noexcept
+	{
+		return is_free( philosopher ) && is_free( (philosopher + 1u) % m_size );
+	}
+
+	// Bit i of the result is set if philosopher i can eat right now.
+	void can_eat_mask( mask_t & result ) const noexcept
+	{
+		for( std::size_t w{}; w != m_free.size(); ++w )
+			result.m_words[ w ] = can_eat_word( w );
+	}
+
+private :
+	std::size_t m_size;
+	std::vector< word_t > m_free;
+	std::vector< word_t > m_reserved;
+
+	static bool test( const std::vector< word_t > & bits, std::size_t i ) noexcept
+	{
+		return 0u != (bits[ i / word_bits ] & (word_t{1} << (i % word_bits)));
+	}
+
+	static void assign(
+		std::vector< word_t > & bits,
+		std::size_t i,
+		bool value ) noexcept
+	{
+		const auto mask = word_t{1} << (i % word_bits);
+		auto & word = bits[ i / word_bits ];
+		word = value ? (word | mask) : (word & ~mask);
+	}
+
+	// Bit i is set if forks i and i+1 of the word are free.
+	word_t can_eat_word( std::size_t w ) const noexcept
+	{
+		word_t next;
+		if( w + 1u != m_free.size() )
+			next = (m_free[ w ] >> 1u) | (m_free[ w + 1u ] << (word_bits - 1u));
+		else
+		{
+			// The right fork of the last philosopher is the fork 0.
+			const auto last_bit = m_size - w * word_bits - 1u;
+			next = (m_free[ w ] >> 1u) | ((m_free.front() & 1u) << last_bit);
+		}
+
+		return m_free[ w ] & next;
+	}
+};
@@ -1,16 +1,54 @@
 #pragma once
 
+#include <dining_philosophers/common/message_pool.hpp>
+#include <dining_philosophers/common/handler_timing.hpp>
+
 #include <so_5/all.hpp>
 
-struct take_t
+// Requests for forks are sent very often, so instances of take_t are
+// allocated from a pool.
+//
+// There is no mbox of the requester inside take_t. The reply should be
+// sent to the mbox from reply_table_t for m_philosopher_index.
+struct take_t final
+	:	public so_5::message_t
+	,	public message_pool::pooled_allocation_t< take_t >
+	,	public handler_timing::timestamped_t
 {
-	const so_5::mbox_t m_who;
-	std::size_t m_philosopher_index;
+	const std::size_t m_philosopher_index;
+
+	explicit take_t( std::size_t philosopher_index )
+		:	m_philosopher_index{ philosopher_index }
+	{}
 };
 
 struct busy_t : public so_5::signal_t {};
 
 struct taken_t : public so_5::signal_t {};
 
+#if defined(DINING_PHILOSOPHERS_HANDLER_TIMING)
+// A signal has no time of creation. So put_t is a message if timing
+// of handlers is turned on.
+struct put_t final
+	:	public so_5::message_t
+	,	public handler_timing::timestamped_t
+{};
+#else
 struct put_t : public so_5::signal_t {};
+#endif
+
+// Withdrawal of the previous take_t from the same philosopher.
+struct cancel_take_t final : public so_5::message_t
+{
+	const std::size_t m_philosopher_index;
+
+	explicit cancel_take_t( std::size_t philosopher_index )
+		:	m_philosopher_index{ philosopher_index }
+	{}
+};
+
+// Reply to cancel_take_t if the request was withdrawn before the fork
+// was given to the philosopher. Otherwise the philosopher receives
+// taken_t and has to return the fork back.
+struct cancelled_t : public so_5::signal_t {};
 
@@ -0,0 +1,281 @@
+#pragma once
+
+//
+// Timing of message handlers of forks and waiters.
+//
+// It is turned on by DINING_PHILOSOPHERS_HANDLER_TIMING macro (see
+// DINING_PHILOSOPHERS_HANDLER_TIMING option in CMakeLists.txt).
+// If the macro isn't defined then all classes below are empty and all
+// methods do nothing, so there is no overhead at all.
+//
+// Two values are measured for every handler:
+// - queueing time: from the creation of a message till the start of
+//   the handler;
+// - service time: the duration of the handler.
+//
+// Usage:
+//
+// handler_timing::table_t m_timing{ "fork_t", { "take", "put" } };
+// ...
+// void on_take( mhood_t<take_t> cmd ) {
+// 	const auto measure = m_timing.measure( 0u, cmd );
+// 	...
+// }
+//
+// Every table_t collects values without synchronization and moves them
+// to the global registry at the destruction. The content of the registry
+// is printed by handler_timing::report().
+//
+
+#if defined(DINING_PHILOSOPHERS_HANDLER_TIMING)
+
+#include <fmt/format.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#endif
+
+#include <initializer_list>
+
+namespace handler_timing {
+
+#if defined(DINING_PHILOSOPHERS_HANDLER_TIMING)
+
+using clock_t = std::chrono::steady_clock;
+
+//
+// timestamped_t
+//
+// Base class for messages those hold the time of creation.
+//
+class timestamped_t
+{
+public :
+	clock_t::time_point sent_at() const noexcept { return m_sent_at; }
+
+private :
+	const clock_t::time_point m_sent_at{ clock_t::now() };
+};
+
+//
+// histogram_t
+//
+// Bucket N holds values in range [2^(N-1), 2^N) nanoseconds.
+//
+class histogram_t
+{
+public :
+	void record( clock_t::duration d ) noexcept
+	{
+		auto ns = static_cast< std::uint64_t >(
+				std::chrono::duration_cast< std::chrono::nanoseconds >( d ).count() );
+		std::size_t bucket{};
+		while( ns && bucket != buckets_count - 1u )
+		{
+			ns >>= 1u;
+			++bucket;
+		}
+
+		++m_buckets[ bucket ];
+		++m_count;
+	}
+
+	void merge( const histogram_t & other ) noexcept
+	{
+		for( std::size_t i{}; i != buckets_count; ++i )
+			m_buckets[ i ] += other.m_buckets[ i ];
+		m_count += other.m_count;
+	}
+
+	std::uint64_t count() const noexcept { return m_count; }
+
+	// Upper bound of a percentile in microseconds.
+	double percentile( double p ) const noexcept
+	{
+		const auto limit = static_cast< std::uint64_t >( p * m_count );
+		std::uint64_t accumulated{};
+		std::size_t bucket{};
+		for( ; bucket != buckets_count - 1u; ++bucket )
+		{
+			accumulated += m_buckets[ bucket ];
+			if( accumulated > limit )
+				break;
+		}
+
+		return static_cast< double >( std::uint64_t{1u} << bucket ) / 1000.0;
+	}
+
+private :
+	static constexpr std::size_t buckets_count = 40u;
+
+	std::array< std::uint64_t, buckets_count > m_buckets{};
+	std::uint64_t m_count{};
+};
+
+struct handler_stats_t
+{
+	histogram_t m_queueing;
+	histogram_t m_service;
+
+	void merge( const handler_stats_t & other ) noexcept
+	{
+		m_queueing.merge( other.m_queueing );
+		m_service.merge( other.m_service );
+	}
+};
+
+//
+// registry_t
+//
+// Values from all tables. Handlers with the same names are merged.
+//
+class registry_t
+{
+public :
+	static registry_t & instance()
+	{
+		static registry_t registry;
+		return registry;
+	}
+
+	void merge( const std::string & name, const handler_stats_t & stats )
+	{
+		std::lock_guard< std::mutex > lock{ m_lock };
+		m_handlers[ name ].merge( stats );
+	}
+
+	void report()
+	{
+		std::lock_guard< std::mutex > lock{ m_lock };
+		for( const auto & [name, stats] : m_handlers )
+			fmt::print( "{}: count: {}, "
+					"queueing p50: <{:.3f}us, p99: <{:.3f}us, "
+					"service p50: <{:.3f}us, p99: <{:.3f}us\n",
+					name,
+					stats.m_service.count(),
+					stats.m_queueing.percentile( 0.5 ),
+					stats.m_queueing.percentile( 0.99 ),
+					stats.m_service.percentile( 0.5 ),
+					stats.m_service.percentile( 0.99 ) );
+	}
+
+	// Values of the next run are collected from scratch.
+	void reset()
+	{
+		std::lock_guard< std::mutex > lock{ m_lock };
+		m_handlers.clear();
+	}
+
+private :
+	std::mutex m_lock;
+	std::map< std::string, handler_stats_t > m_handlers;
+};
+
+//
+// measure_t
+//
+// Records the queueing time at the construction and the service time
+// at the destruction.
+//
+class measure_t
+{
+public :
+	measure_t( handler_stats_t & stats, clock_t::time_point sent_at ) noexcept
+		:	m_stats{ stats }
+		,	m_started_at{ clock_t::now() }
+	{
+		m_stats.m_queueing.record( m_started_at - sent_at );
+	}
+
+	measure_t( const measure_t & ) = delete;
+	measure_t( measure_t && ) = delete;
+
+	~measure_t()
+	{
+		m_stats.m_service.record( clock_t::now() - m_started_at );
+	}
+
+private :
+	handler_stats_t & m_stats;
+	const clock_t::time_point m_started_at;
+};
+
+//
+// table_t
+//
+class table_t
+{
+public :
+	table_t(
+		const char * owner,
+		std::initializer_list< const char * > handlers )
+	{
+		for( const auto * h : handlers )
+			m_names.push_back( fmt::format( "{}::{}", owner, h ) );
+		m_stats.resize( m_names.size() );
+	}
+
+	table_t( const table_t & ) = delete;
+	table_t( table_t && ) = delete;
+
+	~table_t()
+	{
+		for( std::size_t i{}; i != m_names.size(); ++i )
+			registry_t::instance().merge( m_names[ i ], m_stats[ i ] );
+	}
+
+	template< typename Mhood >
+	measure_t measure( std::size_t handler, const Mhood & cmd ) noexcept
+	{
+		return { m_stats[ handler ], cmd->sent_at() };
+	}
+
+private :
+	std::vector< std::string > m_names;
+	std::vector< handler_stats_t > m_stats;
+};
+
+inline void report()
+{
+	registry_t::instance().report();
+}
+
+inline void reset()
+{
+	registry_t::instance().reset();
+}
+
+#else
+
+class timestamped_t {};
+
+class measure_t
+{
+public :
+	// Without a user-provided destructor compilers warn about
+	// unused variables.
+	~measure_t() {}
+};
+
+class table_t
+{
+public :
+	table_t( const char *, std::initializer_list< const char * > ) noexcept {}
+
+	template< typename Mhood >
+	measure_t measure( std::size_t, const Mhood & ) noexcept { return {}; }
+};
+
+inline void report() {}
+
+inline void reset() {}
+
+#endif
+
+} /* namespace handler_timing */
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <fstream>
+#include <optional>
+#include <string>
+
+namespace memory_usage {
+
+// Resident set size of the current process in bytes.
+// It's supported on Linux only, an empty value is returned on other
+// platforms.
+inline std::optional< std::size_t > resident_bytes()
+{
+#if defined(__linux__)
+	std::ifstream status{ "/proc/self/status" };
+	std::string name;
+	while( status >> name )
+	{
+		if( "VmRSS:" == name )
+		{
+			std::size_t kbytes{};
+			if( status >> kbytes )
+				return kbytes * 1024u;
+			break;
+		}
+		std::getline( status, name );
+	}
+#endif
+	return std::nullopt;
+}
+
+} /* namespace memory_usage */
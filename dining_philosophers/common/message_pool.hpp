@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace message_pool {
+
+namespace details {
+
+// Unused block of memory is kept in a single-linked list.
+struct free_block_t
+{
+	free_block_t * m_next;
+};
+
+// Max count of blocks to be transferred between a thread and
+// a shared list at once.
+constexpr std::size_t batch_size = 64u;
+
+// Max count of free blocks to be held by a thread.
+// Extra blocks are moved to a shared list.
+constexpr std::size_t max_local_blocks = 4u * batch_size;
+
+//
+// shared_free_list_t
+//
+// Free blocks that can be used by any thread.
+//
+// A message is usually allocated by one thread (the sender) and
+// deallocated by another (the receiver). Without the shared list free
+// blocks would be accumulated by receivers while senders would have to
+// allocate new blocks all the time.
+//
+class shared_free_list_t
+{
+public :
+	shared_free_list_t() = default;
+	shared_free_list_t( const shared_free_list_t & ) = delete;
+	shared_free_list_t( shared_free_list_t && ) = delete;
+
+	~shared_free_list_t()
+	{
+		while( m_head )
+			::operator delete( std::exchange( m_head, m_head->m_next ) );
+	}
+
+	// Returns a list of no more than batch_size blocks.
+	// Returns nullptr if there is no free blocks.
+	free_block_t * take_batch( std::size_t & count ) noexcept
+	{
+		std::lock_guard< std::mutex > lock{ m_lock };
+
+		free_block_t * head = m_head;
+		free_block_t * tail = nullptr;
+		count = 0u;
+		for( ; m_head && count != batch_size; ++count )
+		{
+			tail = m_head;
+			m_head = m_head->m_next;
+		}
+
+		if( tail )
+			tail->m_next = nullptr;
+
+		return count ? head : nullptr;
+	}
+
+	void put_batch( free_block_t * head, free_block_t * tail ) noexcept
+	{
+		std::lock_guard< std::mutex > lock{ m_lock };
+
+		tail->m_next = m_head;
+		m_head = head;
+	}
+
+private :
+	std::mutex m_lock;
+	free_block_t * m_head{};
+};
+
+//
+// local_free_list_t
+//
+// Free blocks owned by the current thread. Doesn't require any
+// synchronization.
+//
+class local_free_list_t
+{
+public :
+	explicit local_free_list_t( shared_free_list_t & shared ) noexcept
+		:	m_shared{ shared }
+	{}
+
+	local_free_list_t( const local_free_list_t & ) = delete;
+	local_free_list_t( local_free_list_t && ) = delete;
+
+	~local_free_list_t()
+	{
+		// Blocks of finished thread can be reused by other threads.
+		if( m_head )
+			m_shared.put_batch( m_head, last_block() );
+	}
+
+	void * allocate( std::size_t block_size )
+	{
+		if( !m_head )
+			m_head = m_shared.take_batch( m_size );
+
+		if( !m_head )
+			return ::operator new( block_size );
+
+		--m_size;
+		return std::exchange( m_head, m_head->m_next );
+	}
+
+	void deallocate( void * p ) noexcept
+	{
+		auto * block = static_cast< free_block_t * >( p );
+		block->m_next = m_head;
+		m_head = block;
+
+		if( ++m_size > max_local_blocks )
+			give_batch_back();
+	}
+
+private :
+	shared_free_list_t & m_shared;
+
+	free_block_t * m_head{};
+	std::size_t m_size{};
+
+	free_block_t * last_block() const noexcept
+	{
+		auto * b = m_head;
+		while( b->m_next )
+			b = b->m_next;
+		return b;
+	}
+
+	void give_batch_back() noexcept
+	{
+		free_block_t * head = m_head;
+		free_block_t * tail = m_head;
+		for( std::size_t i = 1u; i != batch_size; ++i )
+			tail = tail->m_next;
+
+		m_head = tail->m_next;
+		m_size -= batch_size;
+
+		m_shared.put_batch( head, tail );
+	}
+};
+
+} /* namespace details */
+
+//
+// pooled_allocation_t
+//
+// Base class for messages that should be allocated from a pool instead
+// of the general purpose allocator.
+//
+// Usage:
+//
+// struct my_message_t final
+// 	:	public so_5::message_t
+// 	,	public message_pool::pooled_allocation_t< my_message_t >
+// {...};
+//
+// Every type has its own pool. A deallocated block is kept in a free list
+// of the current thread and is reused by the next allocation on that
+// thread. Excess of free blocks is moved to the shared list from that
+// other threads can take free blocks by batches.
+//
+template< typename T >
+class pooled_allocation_t
+{
+	static constexpr std::size_t block_size() noexcept
+	{
+		return std::max( sizeof(T), sizeof(details::free_block_t) );
+	}
+
+	static details::shared_free_list_t & shared_list()
+	{
+		static details::shared_free_list_t list;
+		return list;
+	}
+
+	static details::local_free_list_t & local_list()
+	{
+		static thread_local details::local_free_list_t list{ shared_list() };
+		return list;
+	}
+
+public :
+	static void * operator new( std::size_t size )
+	{
+		static_assert( alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+				"over-aligned types are not supported" );
+
+		// A derived type can have different size. It can't be placed
+		// into blocks of the pool.
+		if( size != sizeof(T) )
+			return ::operator new( size );
+
+		return local_list().allocate( block_size() );
+	}
+
+	static void operator delete( void * p, std::size_t size ) noexcept
+	{
+		if( size != sizeof(T) )
+			::operator delete( p );
+		else
+			local_list().deallocate( p );
+	}
+};
+
+} /* namespace message_pool */
+
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <dining_philosophers/common/watchdog.hpp>
+#include <dining_philosophers/common/fairness.hpp>
+
+namespace trace {
+
+//
+// observers_params_t
+//
+// Params of optional observers of state changes those can be turned on
+// from the command line.
+//
+struct observers_params_t
+{
+	watchdog_params_t m_watchdog;
+	fairness_params_t m_fairness;
+
+	static observers_params_t from_cmd_line( const cmd_line_args_t & args )
+	{
+		return {
+			watchdog_params_t::from_cmd_line( args ),
+			fairness_params_t::from_cmd_line( args )
+		};
+	}
+
+	observers_t make( const names_holder_t & names ) const
+	{
+		observers_t result;
+		if( m_watchdog.m_enabled )
+			result.push_back( std::make_unique< watchdog_t >( names, m_watchdog ) );
+		if( m_fairness.m_enabled )
+			result.push_back(
+					std::make_unique< fairness_meter_t >( names, m_fairness ) );
+
+		return result;
+	}
+
+	// Observers should be checked with that period.
+	std::chrono::milliseconds tick_period() const noexcept
+	{
+		std::chrono::milliseconds result{ 250 };
+		if( m_watchdog.m_enabled )
+			result = std::min( result, m_watchdog.check_period() );
+		if( m_fairness.m_enabled )
+			result = std::min( result, m_fairness.step() );
+
+		return result;
+	}
+};
+
+} /* namespace trace */
@@ -1,24 +1,102 @@
 #pragma once
 
 #include <dining_philosophers/common/types.hpp>
+#include <dining_philosophers/common/backoff.hpp>
 
+#include <cstdint>
 #include <random>
 #include <chrono>
 
-class random_pause_generator_t
+//
+// xorshift32_engine_t
+//
+// Random engine with 4 bytes of state. It is much worse than std::mt19937
+// (which has a state of 5KB) but it is good enough for pauses of
+// philosophers in very large tables.
+//
+class xorshift32_engine_t
 {
 public :
-	random_pause_generator_t()
+	using result_type = std::uint32_t;
+
+	static constexpr result_type min() noexcept { return 1u; }
+	static constexpr result_type max() noexcept { return ~result_type{}; }
+
+	void seed( result_type value ) noexcept
+	{
+		// Zero state can't be used.
+		m_state = value ? value : 0x9e3779b9u;
+	}
+
+	result_type operator()() noexcept
+	{
+		m_state ^= m_state << 13u;
+		m_state ^= m_state >> 17u;
+		m_state ^= m_state << 5u;
+		return m_state;
+	}
+
+private :
+	result_type m_state{ 1u };
+};
+
+namespace pause_seed {
+
+// splitmix64 finalizer: close values give unrelated results.
+inline std::uint64_t mix( std::uint64_t value ) noexcept
+{
+	value += 0x9e3779b97f4a7c15u;
+	value = (value ^ (value >> 30u)) * 0xbf58476d1ce4e5b9u;
+	value = (value ^ (value >> 27u)) * 0x94d049bb133111ebu;
+	return value ^ (value >> 31u);
+}
+
+// A value that is different for every run.
+inline std::uint64_t for_run()
+{
+	static const std::uint64_t value = mix(
+			(static_cast< std::uint64_t >( std::random_device{}() ) << 32u) ^
+			static_cast< std::uint64_t >(
+					std::chrono::steady_clock::now().time_since_epoch().count() ) );
+	return value;
+}
+
+// A seed for the philosopher with the given index.
+inline std::uint32_t for_philosopher( std::size_t index )
+{
+	const auto value = mix( for_run() ^ mix( index ) );
+	return static_cast< std::uint32_t >( value ^ (value >> 32u) );
+}
+
+} /* namespace pause_seed */
+
+template< typename Engine >
+class basic_pause_generator_t
+{
+public :
+	basic_pause_generator_t()
 	{
 		m_random_engine.seed( reinterpret_cast<std::size_t>(this) % 1000 );
 	}
 
+	// Every philosopher of the table gets its own sequence of pauses.
+	explicit basic_pause_generator_t( std::size_t philosopher_index )
+	{
+		m_random_engine.seed( pause_seed::for_philosopher( philosopher_index ) );
+	}
+
 	auto think_pause( thinking_type_t type )
 	{
 		return std::chrono::milliseconds(
 				random( 10, thinking_type_t::normal == type ? 60 : 30 ) );
 	}
 
+	auto hungry_think_pause( const hungry_backoff_t & backoff )
+	{
+		const auto bounds = backoff.pause_bounds();
+		return std::chrono::milliseconds( random( bounds.first, bounds.second ) );
+	}
+
 	auto eat_pause()
 	{
 		return std::chrono::milliseconds( random( 20, 80 ) );
@@ -30,7 +108,7 @@ public :
 
 private :
 	// Engine for random values generation.
-	std::mt19937 m_random_engine;
+	Engine m_random_engine;
 
 	int
 	random( int l, int h )
@@ -39,3 +117,7 @@ private :
 	}
 };
 
+using random_pause_generator_t = basic_pause_generator_t< std::mt19937 >;
+
+// Pause generator for very large tables.
+using compact_pause_generator_t = basic_pause_generator_t< xorshift32_engine_t >;
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <so_5/all.hpp>
+
+#include <vector>
+
+//
+// reply_table_t
+//
+// Mboxes for replies to philosophers.
+//
+// A request to take a fork holds only the index of the philosopher.
+// The receiver of the request finds the mbox for the reply in this table.
+// So requests don't hold references to mboxes and there is no need to
+// increment/decrement reference counters for every request.
+//
+// An entry is filled before the start of its philosopher and isn't
+// changed after that. Entries are read only when a request from
+// the philosopher is received. Because of that the table can be read
+// from different threads without any synchronization.
+//
+class reply_table_t
+{
+public :
+	explicit reply_table_t( std::size_t philosophers_count )
+		:	m_mboxes( philosophers_count )
+	{}
+
+	reply_table_t( const reply_table_t & ) = delete;
+	reply_table_t( reply_table_t && ) = delete;
+
+	void register_philosopher( std::size_t index, so_5::mbox_t mbox )
+	{
+		m_mboxes[ index ] = std::move(mbox);
+	}
+
+	const so_5::mbox_t & reply_mbox( std::size_t philosopher_index ) const noexcept
+	{
+		return m_mboxes[ philosopher_index ];
+	}
+
+private :
+	std::vector< so_5::mbox_t > m_mboxes;
+};
+
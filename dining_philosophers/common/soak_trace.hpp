@@ -0,0 +1,211 @@
+#pragma once
+
+#include <dining_philosophers/common/trace.hpp>
+#include <dining_philosophers/common/trace_observer.hpp>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+
+namespace trace {
+
+//
+// ring_history_t
+//
+// The last transitions of a philosopher. The capacity is fixed, so
+// the oldest transition is overwritten by the newest one.
+//
+class ring_history_t
+{
+public :
+	explicit ring_history_t( std::size_t capacity )
+		:	m_capacity{ capacity }
+	{
+		m_items.reserve( capacity );
+	}
+
+	void push( history_item_t item )
+	{
+		if( m_items.size() != m_capacity )
+			m_items.push_back( item );
+		else
+		{
+			m_items[ m_oldest ] = item;
+			m_oldest = (m_oldest + 1u) % m_items.size();
+		}
+	}
+
+	// Transitions from the oldest to the newest.
+	history_t to_history() const
+	{
+		history_t result;
+		result.reserve( m_items.size() + 1u );
+		result.insert( result.end(), m_items.begin() + m_oldest, m_items.end() );
+		result.insert( result.end(), m_items.begin(), m_items.begin() + m_oldest );
+		return result;
+	}
+
+private :
+	std::size_t m_capacity;
+	std::vector< history_item_t > m_items;
+	std::size_t m_oldest{};
+};
+
+//
+// soak_trace_t
+//
+// Trace for endless runs. Memory usage doesn't depend on the duration of
+// the run: only the last transitions of every philosopher are stored and
+// all other information is kept in counters.
+//
+// Counters of philosophers are rolling: they cover the time since
+// the previous render and are reset after it. Only the totals for
+// the whole run are cumulative.
+//
+// The stored window is shown periodically or on request (see
+// request_render()).
+//
+class soak_trace_t final : public observer_t
+{
+public :
+	soak_trace_t(
+		const names_holder_t & names,
+		// Count of transitions to be stored for every philosopher.
+		std::size_t window_size,
+		std::chrono::steady_clock::duration step,
+		std::chrono::steady_clock::duration render_period )
+		:	m_names{ names }
+		,	m_step{ step }
+		,	m_render_period{ render_period }
+		,	m_rings( names.size(), ring_history_t{ window_size } )
+		,	m_counters( names.size() )
+		,	m_window_started_at{ std::chrono::steady_clock::now() }
+		,	m_next_render_at{ m_window_started_at + render_period }
+	{}
+
+	// Can be called from a signal handler.
+	static void request_render() noexcept
+	{
+		render_requested().store( true, std::memory_order_relaxed );
+	}
+
+	// Window will be shown on SIGUSR1 (if there is such signal).
+	static void install_signal_handler()
+	{
+#if defined(SIGUSR1)
+		std::signal( SIGUSR1, []( int ) { request_render(); } );
+#endif
+	}
+
+	void on_state_changed(
+		std::size_t index,
+		char state,
+		std::chrono::steady_clock::time_point when ) override
+	{
+		m_rings[ index ].push( history_item_t{ when, state } );
+
+		auto & c = m_counters[ index ];
+		switch( state )
+		{
+		case st_eating: ++c.m_meals; break;
+		case st_wait_left: ++c.m_attempts; break;
+		case st_hungry_thinking: ++c.m_failures; break;
+		default: break;
+		}
+	}
+
+	void on_tick( std::chrono::steady_clock::time_point now ) override
+	{
+		if( render_requested().exchange( false, std::memory_order_relaxed ) ||
+				now >= m_next_render_at )
+		{
+			render( now );
+			m_next_render_at = now + m_render_period;
+		}
+	}
+
+	void on_finish( std::chrono::steady_clock::time_point now ) override
+	{
+		render( now );
+	}
+
+private :
+	struct counters_t
+	{
+		std::uint64_t m_meals{};
+		// Attempts to take the left fork.
+		std::uint64_t m_attempts{};
+		// Attempts that ended by hungry thinking.
+		std::uint64_t m_failures{};
+
+		void add( const counters_t & other ) noexcept
+		{
+			m_meals += other.m_meals;
+			m_attempts += other.m_attempts;
+			m_failures += other.m_failures;
+		}
+	};
+
+	const names_holder_t & m_names;
+	const std::chrono::steady_clock::duration m_step;
+	const std::chrono::steady_clock::duration m_render_period;
+
+	std::vector< ring_history_t > m_rings;
+	// Counters since the previous render.
+	std::vector< counters_t > m_counters;
+	// Counters of all previous windows.
+	counters_t m_whole_run;
+
+	std::chrono::steady_clock::time_point m_window_started_at;
+	std::chrono::steady_clock::time_point m_next_render_at;
+
+	static std::atomic< bool > & render_requested() noexcept
+	{
+		static_assert( std::atomic< bool >::is_always_lock_free,
+				"lock-free atomic is required for signal handlers" );
+
+		static std::atomic< bool > flag{ false };
+		return flag;
+	}
+
+	void render( std::chrono::steady_clock::time_point now )
+	{
+		trace_data_t window;
+		window.reserve( m_rings.size() );
+		for( const auto & ring : m_rings )
+		{
+			window.push_back( ring.to_history() );
+			// The last item is treated as the end of the history by
+			// show_trace_data. So the current state lasts till now.
+			window.back().emplace_back( now, st_done );
+		}
+
+		show_trace_data( m_names, window, m_step );
+
+		fmt::print( "last {:.1f}s:\n",
+				std::chrono::duration< double >( now - m_window_started_at ).count() );
+
+		counters_t window_total;
+		for( std::size_t i{}; i != m_counters.size(); ++i )
+		{
+			auto & c = m_counters[ i ];
+			fmt::print( "[{:>3}]{:>15}: meals: {}, attempts: {}, failures: {}\n",
+					i, m_names[ i ], c.m_meals, c.m_attempts, c.m_failures );
+
+			window_total.add( c );
+			c = counters_t{};
+		}
+		m_whole_run.add( window_total );
+
+		fmt::print( "total: meals: {}, attempts: {}, failures: {}\n",
+				window_total.m_meals, window_total.m_attempts, window_total.m_failures );
+		fmt::print( "whole run: meals: {}, attempts: {}, failures: {}\n",
+				m_whole_run.m_meals, m_whole_run.m_attempts, m_whole_run.m_failures );
+
+		m_window_started_at = now;
+	}
+};
+
+} /* namespace trace */
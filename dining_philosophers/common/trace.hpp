@@ -1,6 +1,7 @@
 #pragma once
 
 #include <dining_philosophers/common/types.hpp>
+#include <dining_philosophers/common/message_pool.hpp>
 
 #include <so_5/all.hpp>
 
@@ -20,7 +21,11 @@ constexpr char st_wait_left = 'L';
 constexpr char st_wait_right = 'R';
 constexpr char st_done = 'q';
 
-struct state_changed_t final : public so_5::message_t
+// A message is sent on every state change, so instances of state_changed_t
+// are allocated from a pool.
+struct state_changed_t final
+	:	public so_5::message_t
+	,	public message_pool::pooled_allocation_t< state_changed_t >
 {
 	std::chrono::steady_clock::time_point m_when;
 	const std::size_t m_index;
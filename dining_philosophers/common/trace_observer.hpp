@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace trace {
+
+//
+// observer_t
+//
+// Consumer of the stream of state changes of philosophers (the same
+// stream that is used for making of the trace).
+//
+// All methods of an observer are called on the same thread. So there is
+// no need for synchronization inside an observer.
+//
+class observer_t
+{
+public :
+	virtual ~observer_t() = default;
+
+	virtual void on_state_changed(
+		std::size_t index,
+		char state,
+		std::chrono::steady_clock::time_point when ) = 0;
+
+	// Called periodically even if there are no state changes.
+	virtual void on_tick( std::chrono::steady_clock::time_point now ) = 0;
+
+	// Called at the end of the simulation.
+	virtual void on_finish( std::chrono::steady_clock::time_point /*now*/ ) {}
+};
+
+using observers_t = std::vector< std::unique_ptr< observer_t > >;
+
+} /* namespace trace */
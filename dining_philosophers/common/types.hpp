@@ -23,5 +23,9 @@ enum class thinking_type_t
 struct philosopher_done_t
 {
 	std::size_t m_philosopher_index;
+	// Count of 'busy' replies received by the philosopher.
+	unsigned int m_busy_replies{};
+	// Count of attempts to take forks abandoned because of a deadline.
+	unsigned int m_timeouts{};
 };
 
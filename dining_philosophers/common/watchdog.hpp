@@ -0,0 +1,219 @@
+#pragma once
+
+#include <dining_philosophers/common/trace.hpp>
+#include <dining_philosophers/common/trace_observer.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace trace {
+
+//
+// watchdog_params_t
+//
+// Params for the detector of starvation and livelock.
+//
+struct watchdog_params_t
+{
+	bool m_enabled;
+	// A philosopher is starving if there were no meals for that time.
+	std::chrono::milliseconds m_starvation_threshold;
+	// There is a livelock if philosophers try to take forks but nobody
+	// has eaten for that time.
+	std::chrono::milliseconds m_livelock_window;
+
+	// Watchdog is turned on by `--watchdog` flag. Thresholds can be set by
+	// `--starvation-threshold MILLISECONDS` and
+	// `--livelock-window MILLISECONDS` options.
+	static watchdog_params_t from_cmd_line( const cmd_line_args_t & args )
+	{
+		return {
+			args.has_flag( "--watchdog" ),
+			std::chrono::milliseconds{ std::stoul(
+					args.value_or( "--starvation-threshold", "1000" ) ) },
+			std::chrono::milliseconds{ std::stoul(
+					args.value_or( "--livelock-window", "500" ) ) }
+		};
+	}
+
+	// Period of checks without state changes. Problems are reported
+	// with a delay not greater than that period.
+	std::chrono::milliseconds check_period() const noexcept
+	{
+		return std::max( std::chrono::milliseconds{ 1 },
+				std::min( m_starvation_threshold, m_livelock_window ) / 4 );
+	}
+};
+
+//
+// watchdog_t
+//
+// Online detector of starvation and livelock.
+//
+// Every state change is handled in O(1): only the state of the philosopher
+// is checked. All philosophers are checked on ticks. Every problem is
+// reported once: at the start of an episode and at its end.
+//
+class watchdog_t final : public observer_t
+{
+public :
+	watchdog_t(
+		const names_holder_t & names,
+		const watchdog_params_t & params )
+		:	m_names{ names }
+		,	m_params{ params }
+		,	m_started_at{ std::chrono::steady_clock::now() }
+		,	m_philosophers( names.size(), philosopher_t{ m_started_at } )
+		,	m_last_meal_at{ m_started_at }
+		,	m_rate_measured_at{ m_started_at }
+	{}
+
+	void on_state_changed(
+		std::size_t index,
+		char state,
+		std::chrono::steady_clock::time_point when ) override
+	{
+		auto & p = m_philosophers[ index ];
+		switch( state )
+		{
+		case st_eating:
+			p.m_last_meal_at = when;
+			if( p.m_starving )
+			{
+				p.m_starving = false;
+				fmt::print( "*** watchdog: {} has eaten after {}ms\n",
+						m_names[ index ], p.m_starving_for.count() );
+			}
+
+			++m_meals;
+			m_last_meal_at = when;
+			m_attempts_since_meal = 0u;
+			if( m_livelock )
+			{
+				m_livelock = false;
+				fmt::print( "*** watchdog: livelock is over, {} has eaten\n",
+						m_names[ index ] );
+			}
+		break;
+
+		case st_wait_left:
+			++m_attempts_since_meal;
+			check_starvation( index, when );
+		break;
+
+		case st_done:
+			p.m_done = true;
+		break;
+
+		default:
+			check_starvation( index, when );
+		}
+	}
+
+	void on_tick( std::chrono::steady_clock::time_point now ) override
+	{
+		for( std::size_t i{}; i != m_philosophers.size(); ++i )
+			check_starvation( i, now );
+
+		check_livelock( now );
+	}
+
+	void on_finish( std::chrono::steady_clock::time_point now ) override
+	{
+		fmt::print( "watchdog: meals: {} ({:.1f}/s), "
+				"starvation episodes: {}, livelock episodes: {}\n",
+				m_meals,
+				m_meals / std::max( 0.001, std::chrono::duration< double >(
+						now - m_started_at ).count() ),
+				m_starvation_episodes,
+				m_livelock_episodes );
+	}
+
+private :
+	struct philosopher_t
+	{
+		std::chrono::steady_clock::time_point m_last_meal_at;
+		std::chrono::milliseconds m_starving_for{};
+		bool m_starving{ false };
+		bool m_done{ false };
+
+		explicit philosopher_t( std::chrono::steady_clock::time_point started_at )
+			:	m_last_meal_at{ started_at }
+		{}
+	};
+
+	const names_holder_t & m_names;
+	const watchdog_params_t m_params;
+	const std::chrono::steady_clock::time_point m_started_at;
+
+	std::vector< philosopher_t > m_philosophers;
+
+	// Info for detection of livelock.
+	std::uint64_t m_meals{};
+	std::chrono::steady_clock::time_point m_last_meal_at;
+	// Attempts to take the left fork since the last meal of anyone.
+	std::uint64_t m_attempts_since_meal{};
+	bool m_livelock{ false };
+
+	// Info for the global meal rate.
+	std::uint64_t m_meals_at_rate_measure{};
+	std::chrono::steady_clock::time_point m_rate_measured_at;
+
+	std::uint64_t m_starvation_episodes{};
+	std::uint64_t m_livelock_episodes{};
+
+	void check_starvation(
+		std::size_t index,
+		std::chrono::steady_clock::time_point now )
+	{
+		auto & p = m_philosophers[ index ];
+		if( p.m_done )
+			return;
+
+		p.m_starving_for = std::chrono::duration_cast< std::chrono::milliseconds >(
+				now - p.m_last_meal_at );
+		if( !p.m_starving && p.m_starving_for >= m_params.m_starvation_threshold )
+		{
+			p.m_starving = true;
+			++m_starvation_episodes;
+			fmt::print( "*** watchdog: {} is starving, hasn't eaten for {}ms\n",
+					m_names[ index ], p.m_starving_for.count() );
+		}
+	}
+
+	void check_livelock( std::chrono::steady_clock::time_point now )
+	{
+		if( m_livelock || now - m_last_meal_at < m_params.m_livelock_window )
+			return;
+
+		// Silence isn't a livelock: every active philosopher should have
+		// made an attempt at least.
+		const auto active = static_cast< std::uint64_t >( std::count_if(
+				m_philosophers.begin(), m_philosophers.end(),
+				[]( const auto & p ) { return !p.m_done; } ) );
+		if( !active || m_attempts_since_meal < active )
+			return;
+
+		m_livelock = true;
+		++m_livelock_episodes;
+
+		// Meal rate since the previous livelock (or since the start).
+		const auto rate = static_cast< double >( m_meals - m_meals_at_rate_measure ) /
+				std::max( 0.001, std::chrono::duration< double >(
+						now - m_rate_measured_at ).count() );
+		m_meals_at_rate_measure = m_meals;
+		m_rate_measured_at = now;
+
+		fmt::print( "*** watchdog: livelock, no meals for {}ms, "
+				"attempts: {}, meal rate before: {:.1f}/s\n",
+				std::chrono::duration_cast< std::chrono::milliseconds >(
+						now - m_last_meal_at ).count(),
+				m_attempts_since_meal,
+				rate );
+	}
+};
+
+} /* namespace trace */
@@ -8,50 +8,63 @@
 void philosopher_process(
 	trace_maker_t & tracer,
 	so_5::mchain_t control_ch,
+	// This channel will be used for replies from forks.
+	// It should be registered in reply_table_t before the start.
+	so_5::mchain_t self_ch,
 	std::size_t philosopher_index,
 	so_5::mbox_t left_fork,
 	so_5::mbox_t right_fork,
-	int meals_count )
+	int meals_count,
+	backoff_policy_t backoff_policy )
 {
 	int meals_eaten{ 0 };
+	unsigned int busy_replies{ 0u };
 
 	// This flag is necessary for tracing of philosopher actions.
 	thinking_type_t thinking_type{ thinking_type_t::normal };
 
 	random_pause_generator_t pause_generator;
 
-	// This channel will be used for replies from forks.
-	auto self_ch = so_5::create_mchain( control_ch->environment() );
+	// Duration of hungry thinking depends on the previous attempts.
+	hungry_backoff_t backoff{ backoff_policy };
 
 	while( meals_eaten < meals_count )
 	{
 		tracer.thinking_started( philosopher_index, thinking_type );
 
 		// Simulate thinking by suspending the thread.
-		std::this_thread::sleep_for( pause_generator.think_pause( thinking_type ) );
+		std::this_thread::sleep_for( thinking_type_t::normal == thinking_type
+				? pause_generator.think_pause( thinking_type )
+				: pause_generator.hungry_think_pause( backoff ) );
 
 		// For the case if we can't take forks.
 		thinking_type = thinking_type_t::hungry;
 
 		// Try to get the left fork.
 		tracer.take_left_attempt( philosopher_index );
-		so_5::send< take_t >( left_fork, self_ch->as_mbox(), philosopher_index );
+		so_5::send< take_t >( left_fork, philosopher_index );
 
 		// Request sent, wait for a reply.
 		so_5::receive( so_5::from( self_ch ).handle_n( 1u ),
-			[]( so_5::mhood_t<busy_t> ) { /* nothing to do */ },
+			[&]( so_5::mhood_t<busy_t> ) {
+				++busy_replies;
+				backoff.on_busy();
+			},
 			[&]( so_5::mhood_t<taken_t> ) {
 				// Left fork is taken.
 				// Try to get the right fork.
 				tracer.take_right_attempt( philosopher_index );
-				so_5::send< take_t >(
-						right_fork, self_ch->as_mbox(), philosopher_index );
+				so_5::send< take_t >( right_fork, philosopher_index );
 
 				// Request sent, wait for a reply.
 				so_5::receive( so_5::from( self_ch ).handle_n( 1u ),
-					[]( so_5::mhood_t<busy_t> ) { /* nothing to do */ },
+					[&]( so_5::mhood_t<busy_t> ) {
+						++busy_replies;
+						backoff.on_busy();
+					},
 					[&]( so_5::mhood_t<taken_t> ) {
 						// Both fork are taken. We can eat.
+						backoff.on_success();
 						tracer.eating_started( philosopher_index );
 
 						// Simulate eating by suspending the thread.
@@ -75,6 +88,7 @@ void philosopher_process(
 
 	// Notify about the completion of the work.
 	tracer.philosopher_done( philosopher_index );
-	so_5::send< philosopher_done_t >( control_ch, philosopher_index );
+	so_5::send< philosopher_done_t >(
+			control_ch, philosopher_index, busy_replies );
 }
 
@@ -0,0 +1,211 @@
+#include <dining_philosophers/csp_based/trace_maker/all.hpp>
+
+#include <dining_philosophers/common/random_generator.hpp>
+#include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/common/observers.hpp>
+#include <dining_philosophers/common/completion_summary.hpp>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+//
+// Shared-memory baseline: one lock per fork.
+//
+// There are no fork processes and no messages between philosophers and
+// forks. A philosopher acquires both forks by std::scoped_lock, which
+// uses a deadlock avoidance algorithm, so there is no need for an order
+// of forks or for a waiter.
+//
+// Philosophers are threads as in other CSP examples, and the trace is
+// collected by the same trace_maker_t.
+//
+
+//
+// spin_lock_t
+//
+// The simplest spin lock for a comparison with std::mutex.
+//
+class spin_lock_t
+{
+public :
+	void lock() noexcept
+	{
+		while( !try_lock() )
+			std::this_thread::yield();
+	}
+
+	bool try_lock() noexcept
+	{
+		return !m_flag.test_and_set( std::memory_order_acquire );
+	}
+
+	void unlock() noexcept
+	{
+		m_flag.clear( std::memory_order_release );
+	}
+
+private :
+	std::atomic_flag m_flag = ATOMIC_FLAG_INIT;
+};
+
+template< typename Lock >
+void philosopher_process(
+	trace_maker_t & tracer,
+	so_5::mchain_t control_ch,
+	std::size_t philosopher_index,
+	Lock & left_fork,
+	Lock & right_fork,
+	int meals_count )
+{
+	int meals_eaten{ 0 };
+	// Count of meals those required waiting for a neighbor.
+	unsigned int lock_waits{ 0u };
+
+	random_pause_generator_t pause_generator;
+
+	while( meals_eaten < meals_count )
+	{
+		tracer.thinking_started( philosopher_index, thinking_type_t::normal );
+
+		// Simulate thinking by suspending the thread.
+		std::this_thread::sleep_for(
+				pause_generator.think_pause( thinking_type_t::normal ) );
+
+		// Both forks are requested at once.
+		tracer.take_left_attempt( philosopher_index );
+
+		// The first attempt doesn't block, it's necessary only for
+		// counting of waits.
+		if( -1 != std::try_lock( left_fork, right_fork ) )
+		{
+			++lock_waits;
+			std::lock( left_fork, right_fork );
+		}
+
+		{
+			std::scoped_lock forks{ std::adopt_lock, left_fork, right_fork };
+
+			// Both fork are taken. We can eat.
+			tracer.eating_started( philosopher_index );
+
+			// Simulate eating by suspending the thread.
+			std::this_thread::sleep_for( pause_generator.eat_pause() );
+
+			// One step closer to the end.
+			++meals_eaten;
+		}
+	}
+
+	// Notify about the completion of the work.
+	tracer.philosopher_done( philosopher_index );
+	so_5::send< philosopher_done_t >(
+			control_ch, philosopher_index, lock_waits );
+}
+
+template< typename Lock >
+void run_simulation(
+	so_5::environment_t & env,
+	const names_holder_t & names,
+	const trace::observers_params_t & observers_params ) noexcept
+{
+	const auto table_size = names.size();
+
+	trace_maker_t tracer{
+			env,
+			names,
+			random_pause_generator_t::trace_step(),
+			observers_params.make( names ),
+			observers_params.tick_period() };
+
+	// Locks are neither copyable nor movable, so the vector is never resized.
+	std::vector< Lock > forks( table_size );
+
+	// Chain for acks from philosophers.
+	auto control_ch = so_5::create_mchain( env );
+
+	const auto started_at = std::chrono::steady_clock::now();
+
+	// Create philosophers.
+	std::vector< std::thread > philosopher_threads( table_size );
+	for( std::size_t i{}; i != table_size; ++i )
+	{
+		// Run philosopher as a thread.
+		philosopher_threads[ i ] = std::thread{
+				philosopher_process< Lock >,
+				std::ref(tracer),
+				control_ch,
+				i,
+				std::ref( forks[ i ] ),
+				std::ref( forks[ (i + 1) % table_size ] ),
+				default_meals_count };
+	}
+
+	// Wait while all philosophers completed.
+	// Only a sample of philosophers is shown.
+	completion_summary_t summary{ table_size };
+	unsigned int lock_waits{ 0u };
+	so_5::receive( so_5::from( control_ch ).handle_n( table_size ),
+			[&]( so_5::mhood_t<philosopher_done_t> cmd ) {
+				lock_waits += cmd->m_busy_replies;
+				if( summary.is_sampled( cmd->m_philosopher_index ) )
+					fmt::print( "{}: done, lock waits: {}\n",
+							names[ cmd->m_philosopher_index ],
+							cmd->m_busy_replies );
+			} );
+
+	// Wait for completion of philosopher threads.
+	for( auto & t : philosopher_threads )
+		t.join();
+
+	const auto elapsed = std::chrono::duration< double >(
+			std::chrono::steady_clock::now() - started_at ).count();
+	const auto meals = table_size * default_meals_count;
+	fmt::print( "meals: {}, lock waits: {}, elapsed: {:.3f}s, meals/s: {:.1f}\n",
+			meals,
+			lock_waits,
+			elapsed,
+			meals / elapsed );
+
+	// Show the result.
+	tracer.done();
+
+	// Stop the SObjectizer.
+	env.stop();
+}
+
+int main( int argc, char ** argv )
+{
+	try
+	{
+		const cmd_line_args_t args{ argc, argv };
+		// Type of fork locks can be changed by `--lock mutex|spin` option.
+		const auto lock_type = args.value_or( "--lock", "mutex" );
+		if( "mutex" != lock_type && "spin" != lock_type )
+			throw std::invalid_argument( "unknown lock type: " + lock_type );
+		const auto observers_params =
+				trace::observers_params_t::from_cmd_line( args );
+
+		const names_holder_t names{
+			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
+			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"
+		};
+
+		so_5::launch( [&]( so_5::environment_t & env ) {
+				if( "mutex" == lock_type )
+					run_simulation< std::mutex >( env, names, observers_params );
+				else
+					run_simulation< spin_lock_t >( env, names, observers_params );
+			} );
+	}
+	catch( const std::exception & ex )
+	{
+		std::cerr << "Error: " << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -3,31 +3,38 @@
 #include <dining_philosophers/common/fork_messages.hpp>
 #include <dining_philosophers/common/random_generator.hpp>
 #include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/common/observers.hpp>
+#include <dining_philosophers/common/completion_summary.hpp>
 
 #include <fmt/format.h>
 
-#include <queue>
+#include <algorithm>
+#include <deque>
 
 void fork_process(
-	so_5::mchain_t fork_ch )
+	so_5::mchain_t fork_ch,
+	const reply_table_t & replies )
 {
 	// State of the fork.
 	bool taken = false;
 
-	// Queue of waiting philosophers.
-	std::queue< so_5::mbox_t > wait_queue;
+	// Queue of waiting philosophers. Every philosopher is identified by index.
+	std::deque< std::size_t > wait_queue;
 
 	// Receive and handle all messages until the channel will be closed.
 	so_5::receive( so_5::from( fork_ch ).handle_all(),
 			[&]( so_5::mhood_t<take_t> cmd ) {
 				if( taken )
 					// Fork already taken. The requester should be stored in queue.
-					wait_queue.push( cmd->m_who );
+					wait_queue.push_back( cmd->m_philosopher_index );
 				else
 				{
 					// Fork can be acquired by the requester.
 					taken = true;
-					so_5::send< taken_t >( cmd->m_who );
+					so_5::send< taken_t >(
+							replies.reply_mbox( cmd->m_philosopher_index ) );
 				}
 			},
 			[&]( so_5::mhood_t<put_t> ) {
@@ -37,8 +44,20 @@ void fork_process(
 				{
 					// The first philosopher from queue should be notified.
 					const auto who = wait_queue.front();
-					wait_queue.pop();
-					so_5::send< taken_t >( who );
+					wait_queue.pop_front();
+					so_5::send< taken_t >( replies.reply_mbox( who ) );
+				}
+			},
+			[&]( so_5::mhood_t<cancel_take_t> cmd ) {
+				const auto it = std::find( wait_queue.begin(), wait_queue.end(),
+						cmd->m_philosopher_index );
+				// If the requester isn't in the queue then the fork is
+				// already given to it. The requester will return the fork.
+				if( it != wait_queue.end() )
+				{
+					wait_queue.erase( it );
+					so_5::send< cancelled_t >(
+							replies.reply_mbox( cmd->m_philosopher_index ) );
 				}
 			} );
 }
@@ -46,69 +65,121 @@ void fork_process(
 void philosopher_process(
 	trace_maker_t & tracer,
 	so_5::mchain_t control_ch,
+	// This channel will be used for replies from forks.
+	// It should be registered in reply_table_t before the start.
+	so_5::mchain_t self_ch,
 	std::size_t philosopher_index,
 	so_5::mbox_t left_fork,
 	so_5::mbox_t right_fork,
-	int meals_count )
+	int meals_count,
+	// Time limit for acquisition of both forks.
+	// Zero value means that there is no deadline.
+	std::chrono::steady_clock::duration deadline )
 {
 	int meals_eaten{ 0 };
+	unsigned int timeouts{ 0u };
+
+	// This flag is necessary for tracing of philosopher actions.
+	thinking_type_t thinking_type{ thinking_type_t::normal };
 
 	random_pause_generator_t pause_generator;
 
-	// This channel will be used for replies from forks.
-	auto self_ch = so_5::create_mchain( control_ch->environment() );
+	// Time point after that the current attempt should be abandoned.
+	std::chrono::steady_clock::time_point deadline_at;
+
+	// Wait for a reply from a fork.
+	// Returns 'false' if the deadline is missed. In that case the request
+	// is withdrawn and the fork isn't held by the philosopher.
+	const auto wait_for_fork = [&]( const so_5::mbox_t & fork ) {
+		bool taken = false;
+		const auto on_taken = [&taken]( so_5::mhood_t<taken_t> ) { taken = true; };
+
+		if( std::chrono::steady_clock::duration::zero() == deadline )
+			so_5::receive( so_5::from( self_ch ).handle_n( 1u ), on_taken );
+		else
+		{
+			const auto now = std::chrono::steady_clock::now();
+			if( now < deadline_at )
+				so_5::receive(
+						so_5::from( self_ch ).handle_n( 1u )
+								.empty_timeout( deadline_at - now ),
+						on_taken );
+
+			if( !taken )
+			{
+				// The fork replies by 'cancelled' or by 'taken' if the fork
+				// has been given to us before the withdrawal.
+				++timeouts;
+				so_5::send< cancel_take_t >( fork, philosopher_index );
+				so_5::receive( so_5::from( self_ch ).handle_n( 1u ),
+					[]( so_5::mhood_t<cancelled_t> ) { /* nothing to do */ },
+					[&fork]( so_5::mhood_t<taken_t> ) {
+						so_5::send< put_t >( fork );
+					} );
+			}
+		}
+
+		return taken;
+	};
 
 	while( meals_eaten < meals_count )
 	{
-		tracer.thinking_started( philosopher_index, thinking_type_t::normal );
+		tracer.thinking_started( philosopher_index, thinking_type );
 
 		// Simulate thinking by suspending the thread.
-		std::this_thread::sleep_for(
-				pause_generator.think_pause( thinking_type_t::normal ) );
+		std::this_thread::sleep_for( pause_generator.think_pause( thinking_type ) );
+
+		// For the case if the deadline will be missed.
+		thinking_type = thinking_type_t::hungry;
+		deadline_at = std::chrono::steady_clock::now() + deadline;
 
 		// Try to get the left fork.
 		tracer.take_left_attempt( philosopher_index );
-		so_5::send< take_t >( left_fork, self_ch->as_mbox(), philosopher_index );
+		so_5::send< take_t >( left_fork, philosopher_index );
 
 		// Request sent, wait for a reply.
-		so_5::receive( so_5::from( self_ch ).handle_n( 1u ),
-			[&]( so_5::mhood_t<taken_t> ) {
-				// Left fork is taken.
-				// Try to get the right fork.
-				tracer.take_right_attempt( philosopher_index );
-				so_5::send< take_t >(
-						right_fork, self_ch->as_mbox(), philosopher_index );
-
-				// Request sent, wait for a reply.
-				so_5::receive( so_5::from( self_ch ).handle_n( 1u ),
-					[&]( so_5::mhood_t<taken_t> ) {
-						// Both fork are taken. We can eat.
-						tracer.eating_started( philosopher_index );
-
-						// Simulate eating by suspending the thread.
-						std::this_thread::sleep_for( pause_generator.eat_pause() );
-
-						// One step closer to the end.
-						++meals_eaten;
-
-						// Right fork should be returned after eating.
-						so_5::send< put_t >( right_fork );
-					} );
-
-				// Left fork should be returned too.
-				so_5::send< put_t >( left_fork );
-			} );
-
+		if( wait_for_fork( left_fork ) )
+		{
+			// Left fork is taken.
+			// Try to get the right fork.
+			tracer.take_right_attempt( philosopher_index );
+			so_5::send< take_t >( right_fork, philosopher_index );
+
+			// Request sent, wait for a reply.
+			if( wait_for_fork( right_fork ) )
+			{
+				// Both fork are taken. We can eat.
+				tracer.eating_started( philosopher_index );
+
+				// Simulate eating by suspending the thread.
+				std::this_thread::sleep_for( pause_generator.eat_pause() );
+
+				// One step closer to the end.
+				++meals_eaten;
+
+				// Right fork should be returned after eating.
+				so_5::send< put_t >( right_fork );
+
+				// Next thinking will be normal, not 'hungry_thinking'.
+				thinking_type = thinking_type_t::normal;
+			}
+
+			// Left fork should be returned too.
+			so_5::send< put_t >( left_fork );
+		}
 	}
 
 	// Notify about the completion of the work.
 	tracer.philosopher_done( philosopher_index );
-	so_5::send< philosopher_done_t >( control_ch, philosopher_index );
+	so_5::send< philosopher_done_t >(
+			control_ch, philosopher_index, 0u, timeouts );
 }
 
 void run_simulation(
 	so_5::environment_t & env,
-	const names_holder_t & names ) noexcept
+	const names_holder_t & names,
+	std::chrono::steady_clock::duration deadline,
+	const trace::observers_params_t & observers_params ) noexcept
 {
 	const auto table_size = names.size();
 	const auto join_all = []( std::vector<std::thread> & threads ) {
@@ -119,7 +190,18 @@ void run_simulation(
 	trace_maker_t tracer{
 			env,
 			names,
-			random_pause_generator_t::trace_step() };
+			random_pause_generator_t::trace_step(),
+			observers_params.make( names ),
+			observers_params.tick_period() };
+
+	// Personal channels of philosophers for replies from forks.
+	std::vector< so_5::mchain_t > philosopher_chains;
+	reply_table_t replies{ table_size };
+	for( std::size_t i{}; i != table_size; ++i )
+	{
+		philosopher_chains.emplace_back( so_5::create_mchain(env) );
+		replies.register_philosopher( i, philosopher_chains.back()->as_mbox() );
+	}
 
 	// Create forks.
 	std::vector< so_5::mchain_t > fork_chains;
@@ -130,7 +212,8 @@ void run_simulation(
 		// Personal channel for fork.
 		fork_chains.emplace_back( so_5::create_mchain(env) );
 		// Run fork as a thread.
-		fork_threads[ i ] = std::thread{ fork_process, fork_chains.back() };
+		fork_threads[ i ] = std::thread{
+				fork_process, fork_chains.back(), std::cref(replies) };
 	}
 
 	// Chain for acks from philosophers.
@@ -143,10 +226,12 @@ void run_simulation(
 						philosopher_process,
 						std::ref(tracer),
 						control_ch,
+						philosopher_chains[ index ],
 						index,
 						fork_chains[ left_fork_idx ]->as_mbox(),
 						fork_chains[ right_fork_idx ]->as_mbox(),
-						default_meals_count };
+						default_meals_count,
+						deadline };
 			};
 	std::vector< std::thread > philosopher_threads( table_size );
 	for( std::size_t i{}; i != table_size - 1u; ++i )
@@ -161,10 +246,17 @@ void run_simulation(
 			0u );
 
 	// Wait while all philosophers completed.
+	// Only a sample of philosophers is shown.
+	completion_summary_t summary{ table_size };
 	so_5::receive( so_5::from( control_ch ).handle_n( table_size ),
-			[&names]( so_5::mhood_t<philosopher_done_t> cmd ) {
-				fmt::print( "{}: done\n", names[ cmd->m_philosopher_index ] );
+			[&]( so_5::mhood_t<philosopher_done_t> cmd ) {
+				summary.add( *cmd );
+				if( summary.is_sampled( cmd->m_philosopher_index ) )
+					fmt::print( "{}: done, timeouts: {}\n",
+							names[ cmd->m_philosopher_index ],
+							cmd->m_timeouts );
 			} );
+	summary.show();
 
 	// Wait for completion of philosopher threads.
 	join_all( philosopher_threads );
@@ -183,17 +275,25 @@ void run_simulation(
 	env.stop();
 }
 
-int main()
+int main( int argc, char ** argv )
 {
 	try
 	{
+		const cmd_line_args_t args{ argc, argv };
+		// Time limit for acquisition of forks can be set by
+		// `--deadline MILLISECONDS` option. There is no limit by default.
+		const std::chrono::milliseconds deadline{
+				std::stoul( args.value_or( "--deadline", "0" ) ) };
+		const auto observers_params =
+				trace::observers_params_t::from_cmd_line( args );
+
 		const names_holder_t names{
 			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
 			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"
 		};
 
 		so_5::launch( [&]( so_5::environment_t & env ) {
-				run_simulation( env, names );
+				run_simulation( env, names, deadline, observers_params );
 			} );
 	}
 	catch( const std::exception & ex )
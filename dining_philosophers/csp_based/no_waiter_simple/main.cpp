@@ -2,27 +2,37 @@
 #include <dining_philosophers/csp_based/trace_maker/all.hpp>
 
 #include <dining_philosophers/common/defaults.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/observers.hpp>
+#include <dining_philosophers/common/completion_summary.hpp>
 
 #include <fmt/format.h>
 
 void fork_process(
-	so_5::mchain_t fork_ch )
+	so_5::mchain_t fork_ch,
+	const reply_table_t & replies )
 {
 	// State of the fork.
 	bool taken = false;
 
+	handler_timing::table_t timing{ "fork_process", { "take", "put" } };
+
 	// Receive and handle all messages until the channel will be closed.
 	so_5::receive( so_5::from( fork_ch ).handle_all(),
 			[&]( so_5::mhood_t<take_t> cmd ) {
+				const auto measure = timing.measure( 0u, cmd );
+				const auto & reply_to = replies.reply_mbox( cmd->m_philosopher_index );
 				if( taken )
-					so_5::send< busy_t >( cmd->m_who );
+					so_5::send< busy_t >( reply_to );
 				else
 				{
 					taken = true;
-					so_5::send< taken_t >( cmd->m_who );
+					so_5::send< taken_t >( reply_to );
 				}
 			},
-			[&]( so_5::mhood_t<put_t> ) {
+			[&]( so_5::mhood_t<put_t> cmd ) {
+				const auto measure = timing.measure( 1u, cmd );
 				if( taken )
 					taken = false;
 			} );
@@ -30,7 +40,9 @@ void fork_process(
 
 void run_simulation(
 	so_5::environment_t & env,
-	const names_holder_t & names ) noexcept
+	const names_holder_t & names,
+	backoff_policy_t backoff_policy,
+	const trace::observers_params_t & observers_params ) noexcept
 {
 	const auto table_size = names.size();
 	const auto join_all = []( std::vector<std::thread> & threads ) {
@@ -41,7 +53,18 @@ void run_simulation(
 	trace_maker_t tracer{
 			env,
 			names,
-			random_pause_generator_t::trace_step() };
+			random_pause_generator_t::trace_step(),
+			observers_params.make( names ),
+			observers_params.tick_period() };
+
+	// Personal channels of philosophers for replies from forks.
+	std::vector< so_5::mchain_t > philosopher_chains;
+	reply_table_t replies{ table_size };
+	for( std::size_t i{}; i != table_size; ++i )
+	{
+		philosopher_chains.emplace_back( so_5::create_mchain(env) );
+		replies.register_philosopher( i, philosopher_chains.back()->as_mbox() );
+	}
 
 	// Create forks.
 	std::vector< so_5::mchain_t > fork_chains;
@@ -52,7 +75,8 @@ void run_simulation(
 		// Personal channel for fork.
 		fork_chains.emplace_back( so_5::create_mchain(env) );
 		// Run fork as a thread.
-		fork_threads[ i ] = std::thread{ fork_process, fork_chains.back() };
+		fork_threads[ i ] = std::thread{
+				fork_process, fork_chains.back(), std::cref(replies) };
 	}
 
 	// Chain for acks from philosophers.
@@ -67,17 +91,26 @@ void run_simulation(
 				philosopher_process,
 				std::ref(tracer),
 				control_ch,
+				philosopher_chains[ i ],
 				i,
 				fork_chains[ i ]->as_mbox(),
 				fork_chains[ (i + 1) % table_size ]->as_mbox(),
-				default_meals_count };
+				default_meals_count,
+				backoff_policy };
 	}
 
 	// Wait while all philosophers completed.
+	// Only a sample of philosophers is shown.
+	completion_summary_t summary{ table_size };
 	so_5::receive( so_5::from( control_ch ).handle_n( table_size ),
-			[&names]( so_5::mhood_t<philosopher_done_t> cmd ) {
-				fmt::print( "{}: done\n", names[ cmd->m_philosopher_index ] );
+			[&]( so_5::mhood_t<philosopher_done_t> cmd ) {
+				summary.add( *cmd );
+				if( summary.is_sampled( cmd->m_philosopher_index ) )
+					fmt::print( "{}: done, busy replies: {}\n",
+							names[ cmd->m_philosopher_index ],
+							cmd->m_busy_replies );
 			} );
+	summary.show();
 
 	// Wait for completion of philosopher threads.
 	join_all( philosopher_threads );
@@ -96,18 +129,27 @@ void run_simulation(
 	env.stop();
 }
 
-int main()
+int main( int argc, char ** argv )
 {
 	try
 	{
+		const cmd_line_args_t args{ argc, argv };
+		// Policy for hungry thinking can be changed by `--backoff NAME` option.
+		const auto backoff_policy = backoff_policy_from_string(
+				args.value_or( "--backoff", "exponential" ) );
+		const auto observers_params =
+				trace::observers_params_t::from_cmd_line( args );
+
 		const names_holder_t names{
 			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
 			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"
 		};
 
 		so_5::launch( [&]( so_5::environment_t & env ) {
-				run_simulation( env, names );
+				run_simulation( env, names, backoff_policy, observers_params );
 			} );
+
+		handler_timing::report();
 	}
 	catch( const std::exception & ex )
 	{
@@ -12,9 +12,13 @@
 trace_maker_t::trace_maker_t(
 	so_5::environment_t & env,
 	const names_holder_t & names,
-	std::chrono::steady_clock::duration step )
+	std::chrono::steady_clock::duration step,
+	trace::observers_t observers,
+	std::chrono::steady_clock::duration tick_period )
 	:	m_names{ names }
 	,	m_step{ step }
+	,	m_observers{ std::move(observers) }
+	,	m_tick_period{ tick_period }
 	,	m_ch{ so_5::create_mchain( env ) }
 {
 	m_trace_thread = std::thread{ trace_maker_t::thread_func, this };
@@ -67,10 +71,38 @@ void trace_maker_t::thread_func( trace_maker_t * self )
 {
 	auto trace_data = trace::make_trace_data( self->m_names.size() );
 
-	so_5::receive( so_5::from( self->m_ch ).handle_all(),
-			[&trace_data]( so_5::mhood_t< trace::state_changed_t > cmd ) {
+	const auto on_state_changed =
+			[self, &trace_data]( so_5::mhood_t< trace::state_changed_t > cmd ) {
 				trace_data[ cmd->m_index ].emplace_back( cmd->m_when, cmd->m_state );
-			} );
+				for( auto & o : self->m_observers )
+					o->on_state_changed( cmd->m_index, cmd->m_state, cmd->m_when );
+			};
+
+	if( self->m_observers.empty() )
+		so_5::receive( so_5::from( self->m_ch ).handle_all(), on_state_changed );
+	else
+	{
+		// Observers have to be called periodically, so receive is limited
+		// by the tick period.
+		for(;;)
+		{
+			const auto result = so_5::receive(
+					so_5::from( self->m_ch ).handle_all().total_time( self->m_tick_period ),
+					on_state_changed );
+
+			const auto now = std::chrono::steady_clock::now();
+			if( so_5::mchain_props::extraction_status_t::chain_closed ==
+					result.status() )
+			{
+				for( auto & o : self->m_observers )
+					o->on_finish( now );
+				break;
+			}
+
+			for( auto & o : self->m_observers )
+				o->on_tick( now );
+		}
+	}
 
 	trace::show_trace_data( self->m_names, trace_data, self->m_step );
 }
@@ -1,19 +1,25 @@
 #pragma once
 
 #include <dining_philosophers/common/types.hpp>
+#include <dining_philosophers/common/trace_observer.hpp>
 
 #include <so_5/all.hpp>
 
 //
 // trace_maker_t
 //
+// State changes are passed to observers (if any) on the trace thread.
+//
 class trace_maker_t final
 {
 public :
 	trace_maker_t(
 		so_5::environment_t & env,
 		const names_holder_t & names,
-		std::chrono::steady_clock::duration step );
+		std::chrono::steady_clock::duration step,
+		trace::observers_t observers = {},
+		std::chrono::steady_clock::duration tick_period =
+				std::chrono::milliseconds{ 250 } );
 	~trace_maker_t();
 
 	trace_maker_t( const trace_maker_t & ) = delete;
@@ -35,6 +41,8 @@ public :
 private :
 	const names_holder_t & m_names;
 	const std::chrono::steady_clock::duration m_step;
+	const trace::observers_t m_observers;
+	const std::chrono::steady_clock::duration m_tick_period;
 
 	so_5::mchain_t m_ch;
 
@@ -2,173 +2,87 @@
 #include <dining_philosophers/csp_based/trace_maker/all.hpp>
 
 #include <dining_philosophers/common/defaults.hpp>
-
-#include <so_5_extra/mboxes/proxy.hpp>
+#include <dining_philosophers/common/reply_table.hpp>
+#include <dining_philosophers/common/fork_bitset.hpp>
+#include <dining_philosophers/common/cmd_line.hpp>
+#include <dining_philosophers/common/observers.hpp>
+#include <dining_philosophers/common/completion_summary.hpp>
 
 #include <fmt/format.h>
 
 namespace details {
 
-// Message for delivering extended information about 'take' request.
-struct extended_take_t final : public so_5::message_t
-{
-	const so_5::mbox_t m_who;
-	const std::size_t m_philosopher_index;
-	const std::size_t m_fork_index;
-
-	extended_take_t(
-		so_5::mbox_t who,
-		std::size_t philosopher_index,
-		std::size_t fork_index )
-		:	m_who{ std::move(who) }
-		,	m_philosopher_index{ philosopher_index }
-		,	m_fork_index{ fork_index }
-	{}
-};
-
-// Message for delivering extended information about 'put' request.
-struct extended_put_t final : public so_5::message_t
-{
-	const std::size_t m_fork_index;
-
-	extended_put_t(
-		std::size_t fork_index )
-		:	m_fork_index{ fork_index }
-	{}
-};
-
-// Special mbox that translates 'take_t' to 'extended_take_t' and
-// 'put_t' to 'extended_put_t'.
-//
-// Mbox should implement several methods inherited from
-// so_5::abstract_message_box_t class. It's a very boring tasks.
-// But there is a special proxy class in so_5_extra project that already
-// do exactly that. Therefore wrapping_mbox_t is derived from that
-// proxy instead of so_5::abstract_message_box_t.
-//
-class wrapping_mbox_t final : public so_5::extra::mboxes::proxy::simple_t
-{
-	using base_type_t = so_5::extra::mboxes::proxy::simple_t;
-
-	// Where messages should be delivered.
-	const so_5::mbox_t m_target;
-	// Index of fork to be placed into extended_take_t and extended_put_t.
-	const std::size_t m_fork_index;
-
-	// IDs of types to be intercepted and translated.
-	static std::type_index original_take_type;
-	static std::type_index original_put_type;
-
-public :
-	wrapping_mbox_t(
-		const so_5::mbox_t & target,
-		std::size_t fork_index )
-		:	base_type_t{ target }
-		,	m_target{ target }
-		,	m_fork_index{ fork_index }
-	{}
-
-	// This is the main method of so_5::abstract_message_box_t for message
-	// delivery. We override it to intercept and translate some types of
-	// messages.
-	void do_deliver_message(
-		so_5::message_delivery_mode_t delivery_mode,
-		const std::type_index & msg_type,
-		const so_5::message_ref_t & message,
-		unsigned int overlimit_reaction_deep ) override
-	{
-		if( original_take_type == msg_type )
-		{
-			// Take access to the content of original message.
-			const auto & original_msg = so_5::message_payload_type<::take_t>::
-					payload_reference( *message );
-			// Send new message instead of original one.
-			so_5::send< extended_take_t >(
-					m_target,
-					original_msg.m_who,
-					original_msg.m_philosopher_index,
-					m_fork_index );
-		}
-		else if( original_put_type == msg_type )
-		{
-			// Send new message instead of original signal.
-			so_5::send< extended_put_t >( m_target, m_fork_index );
-		}
-		else
-			base_type_t::do_deliver_message(
-					delivery_mode,
-					msg_type,
-					message,
-					overlimit_reaction_deep );
-	}
-
-	// Factory method just for simplicity of wrapping_mbox_t creation.
-	static auto make(
-		const so_5::mbox_t & target,
-		std::size_t fork_index )
-	{
-		return so_5::mbox_t{ new wrapping_mbox_t{ target, fork_index } };
-	}
-};
-
-std::type_index wrapping_mbox_t::original_take_type{ typeid(::take_t) };
-std::type_index wrapping_mbox_t::original_put_type{ typeid(::put_t) };
-
 //
 // waiter_logic_t
 //
+// Every "fork" has its own channel. The waiter reads all those channels
+// and knows the index of the fork from the channel a message is extracted
+// from. Because of that original take_t and put_t messages are handled
+// by the waiter as is, without any translation into new messages.
+//
 class waiter_logic_t final
 {
 public :
 	waiter_logic_t(
-		const so_5::mbox_t & msg_target,
+		so_5::environment_t & env,
 		std::size_t forks_count,
+		const reply_table_t & replies,
 		// Amount of time after that a philosopher should take a
 		// priority acquiring forks.
 		std::chrono::steady_clock::duration failures_threshold )
-		:	m_failures_threshold{ failures_threshold }
-		,	m_fork_states( forks_count, fork_state_t::free )
+		:	m_replies{ replies }
+		,	m_failures_threshold{ failures_threshold }
+		,	m_fork_states( forks_count )
 		,	m_failures( forks_count, failure_info_t{} )
 	{
-		// Mboxes for every "fork" should be created.
-		m_fork_mboxes.reserve( forks_count );
+		// Channels for every "fork" should be created.
+		m_fork_chains.reserve( forks_count );
 		for( std::size_t i{}; i != forks_count; ++i )
-			m_fork_mboxes.push_back(
-					details::wrapping_mbox_t::make( msg_target, i ) );
+			m_fork_chains.push_back( so_5::create_mchain( env ) );
+	}
+
+	std::size_t forks_count() const noexcept
+	{
+		return m_fork_chains.size();
+	}
+
+	// Get channel of fork with specified index.
+	const so_5::mchain_t & fork_chain( std::size_t index ) const noexcept
+	{
+		return m_fork_chains[ index ];
 	}
 
 	// Get mbox of fork with specified index.
-	const so_5::mbox_t & fork_mbox( std::size_t index ) const noexcept
+	so_5::mbox_t fork_mbox( std::size_t index ) const
+	{
+		return m_fork_chains[ index ]->as_mbox();
+	}
+
+	// Channels of all "forks" should be closed to finish the work of the waiter.
+	void close_fork_chains()
 	{
-		return m_fork_mboxes[ index ];
+		for( auto & ch : m_fork_chains )
+			so_5::close_drop_content( so_5::terminate_if_throws, ch );
 	}
 
 	// Actual handler for 'take' request.
-	void on_take_fork( so_5::mhood_t<extended_take_t> cmd )
+	void on_take_fork( so_5::mhood_t<take_t> cmd, std::size_t fork_index )
 	{
 		// Use the fact that index of left fork is always equal to
 		// index of the philosopher itself.
-		if( cmd->m_fork_index == cmd->m_philosopher_index )
-			handle_take_left_fork( std::move(cmd) );
+		if( fork_index == cmd->m_philosopher_index )
+			handle_take_left_fork( std::move(cmd), fork_index );
 		else
-			handle_take_right_fork( std::move(cmd) );
+			handle_take_right_fork( std::move(cmd), fork_index );
 	}
 
 	// Actual handler for 'put' request.
-	void on_put_fork( so_5::mhood_t<extended_put_t> cmd )
+	void on_put_fork( std::size_t fork_index )
 	{
-		m_fork_states[ cmd->m_fork_index ] = fork_state_t::free;
+		m_fork_states.set( fork_index, fork_state_t::free );
 	}
 
 private :
-	// Every "fork" can be in one on these states.
-	enum class fork_state_t
-	{
-		free,
-		taken,
-		reserved
-	};
-
 	// Description of failures of a philosopher.
 	class failure_info_t
 	{
@@ -213,29 +127,31 @@ private :
 		}
 	};
 
+	// Mboxes of philosophers for replies.
+	const reply_table_t & m_replies;
+
 	// Amount of time after that a philosopher should take a
 	// priority acquiring forks.
 	const std::chrono::steady_clock::duration m_failures_threshold;
 
-	// Mboxes for "forks".
-	std::vector< so_5::mbox_t > m_fork_mboxes;
+	// Channels for "forks".
+	std::vector< so_5::mchain_t > m_fork_chains;
 
 	// Current states for "forks".
-	std::vector< fork_state_t > m_fork_states;
+	fork_bitset_t m_fork_states;
 
 	// Information of philisophers' failuers.
 	// Every item in that vector related to the corresponding philosopher.
 	std::vector< failure_info_t > m_failures;
 
 	// Actual implementation of 'take' request for left fork.
-	void handle_take_left_fork( so_5::mhood_t<extended_take_t> cmd )
+	void handle_take_left_fork(
+		so_5::mhood_t<take_t> cmd,
+		std::size_t left_fork_index )
 	{
-		const auto left_fork_index = cmd->m_fork_index;
 		const auto right_fork_index = (left_fork_index + 1) % m_fork_states.size();
 		// Philopsoher can eat only if both fork are free now.
-		bool can_eat =
-				(fork_state_t::free == m_fork_states[ left_fork_index ]) &&
-				(fork_state_t::free == m_fork_states[ right_fork_index ]);
+		bool can_eat = m_fork_states.can_eat( left_fork_index );
 
 		if( can_eat )
 		{
@@ -265,36 +181,39 @@ private :
 			m_failures[ cmd->m_philosopher_index ].clear();
 
 			// Left fork will be taken to the requester right now.
-			m_fork_states[ left_fork_index ] = fork_state_t::taken;
+			m_fork_states.set( left_fork_index, fork_state_t::taken );
 			// But the right fork will be marked as reserver until next 'take' request.
-			m_fork_states[ right_fork_index ] = fork_state_t::reserved;
+			m_fork_states.set( right_fork_index, fork_state_t::reserved );
 
-			so_5::send< taken_t >( cmd->m_who );
+			so_5::send< taken_t >(
+					m_replies.reply_mbox( cmd->m_philosopher_index ) );
 		}
 		else
 		{
 			// Failures info should be update for the requester.
 			m_failures[ cmd->m_philosopher_index ].increment();
 
-			so_5::send< busy_t >( cmd->m_who );
+			so_5::send< busy_t >(
+					m_replies.reply_mbox( cmd->m_philosopher_index ) );
 		}
 	}
 
 	// Actual implementation of 'take' request for right fork.
-	void handle_take_right_fork( so_5::mhood_t<extended_take_t> cmd )
+	void handle_take_right_fork(
+		so_5::mhood_t<take_t> cmd,
+		std::size_t fork_index )
 	{
-		const auto fork_index = cmd->m_fork_index;
-
-		if( fork_state_t::reserved != m_fork_states[ fork_index ] )
+		if( fork_state_t::reserved != m_fork_states.state( fork_index ) )
 			throw std::runtime_error(
 					fmt::format( "unexpected state for right fork, state: {},"
 							" fork_index: {}, philosopher_index: {}",
-							static_cast<int>(m_fork_states[fork_index]),
+							static_cast<int>(m_fork_states.state( fork_index )),
 							fork_index,
 							cmd->m_philosopher_index ) );
 
-		m_fork_states[ fork_index ] = fork_state_t::taken;
-		so_5::send< taken_t >( cmd->m_who );
+		m_fork_states.set( fork_index, fork_state_t::taken );
+		so_5::send< taken_t >(
+				m_replies.reply_mbox( cmd->m_philosopher_index ) );
 	}
 
 	// Should this failure info be considered at all?
@@ -341,22 +260,34 @@ private :
 } /* namespace details */
 
 void waiter_process(
-	so_5::mchain_t waiter_ch,
 	details::waiter_logic_t & logic )
 {
-	// Receive and handle all messages until the channel will be closed.
-	so_5::receive( so_5::from( waiter_ch ).handle_all(),
-			[&]( so_5::mhood_t<details::extended_take_t> cmd ) {
-				logic.on_take_fork( std::move(cmd) );
-			},
-			[&]( so_5::mhood_t<details::extended_put_t> cmd ) {
-				logic.on_put_fork( std::move(cmd) );
-			} );
+	// There is a case for every channel of "fork". Handlers of that case
+	// capture the index of the fork.
+	auto forks = so_5::make_extensible_select( so_5::from_all().handle_all() );
+
+	handler_timing::table_t timing{ "waiter_process", { "take", "put" } };
+
+	for( std::size_t i{}; i != logic.forks_count(); ++i )
+		so_5::add_select_cases( forks,
+				so_5::receive_case( logic.fork_chain( i ),
+						[&logic, &timing, i]( so_5::mhood_t<take_t> cmd ) {
+							const auto measure = timing.measure( 0u, cmd );
+							logic.on_take_fork( std::move(cmd), i );
+						},
+						[&logic, &timing, i]( so_5::mhood_t<put_t> cmd ) {
+							const auto measure = timing.measure( 1u, cmd );
+							logic.on_put_fork( i );
+						} ) );
+
+	// Receive and handle all messages until all channels will be closed.
+	so_5::select( forks );
 }
 
 void run_simulation(
 	so_5::environment_t & env,
-	const names_holder_t & names ) noexcept
+	const names_holder_t & names,
+	const trace::observers_params_t & observers_params ) noexcept
 {
 	const auto table_size = names.size();
 	const auto join_all = []( std::vector<std::thread> & threads ) {
@@ -367,18 +298,28 @@ void run_simulation(
 	trace_maker_t tracer{
 			env,
 			names,
-			random_pause_generator_t::trace_step() };
+			random_pause_generator_t::trace_step(),
+			observers_params.make( names ),
+			observers_params.tick_period() };
+
+	// Personal channels of philosophers for replies from the waiter.
+	std::vector< so_5::mchain_t > philosopher_chains;
+	reply_table_t replies{ table_size };
+	for( std::size_t i{}; i != table_size; ++i )
+	{
+		philosopher_chains.emplace_back( so_5::create_mchain(env) );
+		replies.register_philosopher( i, philosopher_chains.back()->as_mbox() );
+	}
 
 	// Create and run waiter.
-	auto waiter_ch = so_5::create_mchain( env );
 	details::waiter_logic_t waiter_logic{
-			waiter_ch->as_mbox(),
+			env,
 			table_size,
+			replies,
 			std::chrono::milliseconds(100)
 	};
 	std::thread waiter_thread{
 			waiter_process,
-			waiter_ch,
 			std::ref(waiter_logic)
 	};
 
@@ -394,23 +335,32 @@ void run_simulation(
 				philosopher_process,
 				std::ref(tracer),
 				control_ch,
+				philosopher_chains[ i ],
 				i,
 				waiter_logic.fork_mbox( i ),
 				waiter_logic.fork_mbox( (i + 1) % table_size ),
-				default_meals_count };
+				default_meals_count,
+				backoff_policy_t::uniform };
 	}
 
 	// Wait while all philosophers completed.
+	// Only a sample of philosophers is shown.
+	completion_summary_t summary{ table_size };
 	so_5::receive( so_5::from( control_ch ).handle_n( table_size ),
-			[&names]( so_5::mhood_t<philosopher_done_t> cmd ) {
-				fmt::print( "{}: done\n", names[ cmd->m_philosopher_index ] );
+			[&]( so_5::mhood_t<philosopher_done_t> cmd ) {
+				summary.add( *cmd );
+				if( summary.is_sampled( cmd->m_philosopher_index ) )
+					fmt::print( "{}: done, busy replies: {}\n",
+							names[ cmd->m_philosopher_index ],
+							cmd->m_busy_replies );
 			} );
+	summary.show();
 
 	// Wait for completion of philosopher threads.
 	join_all( philosopher_threads );
 
-	// Close waiter channel.
-	so_5::close_drop_content( so_5::terminate_if_throws, waiter_ch );
+	// Close channels of "forks".
+	waiter_logic.close_fork_chains();
 
 	// Wait for completion of waiter thread.
 	waiter_thread.join();
@@ -422,18 +372,24 @@ void run_simulation(
 	env.stop();
 }
 
-int main()
+int main( int argc, char ** argv )
 {
 	try
 	{
+		const cmd_line_args_t args{ argc, argv };
+		const auto observers_params =
+				trace::observers_params_t::from_cmd_line( args );
+
 		const names_holder_t names{
 			"Socrates", "Plato", "Aristotle", "Descartes", "Spinoza", "Kant",
 			"Schopenhauer", "Nietzsche", "Wittgenstein", "Heidegger", "Sartre"
 		};
 
 		so_5::launch( [&]( so_5::environment_t & env ) {
-				run_simulation( env, names );
+				run_simulation( env, names, observers_params );
 			} );
+
+		handler_timing::report();
 	}
 	catch( const std::exception & ex )
 	{